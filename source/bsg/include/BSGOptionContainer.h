@@ -1,13 +1,18 @@
 #ifndef BSG_OPTIONCONTAINER
 #define BSG_OPTIONCONTAINER
 
+#include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <set>
 #include <string>
+#include <vector>
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/parsers.hpp>
 #include <boost/program_options/variables_map.hpp>
 
+#include "BSGOptions.h"
+
 /**
  * Macro to easily get the options from the OptionContainer object
  *
@@ -29,7 +34,8 @@ namespace po = boost::program_options;
 /**
  * Class that combines all options from commandline, configuration files and
  * environment variables.
- * Implemented as a Singleton
+ * The instance used by the BSG executable is a singleton, but other instances
+ * can be created to parse the options of additional calculations.
  */
 class BSGOptionContainer {
  public:
@@ -40,6 +46,16 @@ class BSGOptionContainer {
     static BSGOptionContainer instance(argc, argv);
     return instance;
   }
+
+  /**
+   * Parse the BSG and NME options from the command line and the configuration and input files it names
+   *
+   * @param values option values to use instead of the input file, e.g. a
+   * row of a batch table. They take precedence over the configuration file,
+   * but not over the command line.
+   */
+  BSGOptionContainer(int, char**, const OptionValues* values = NULL);
+
   /**
    * Get the option from the container
    *
@@ -56,39 +72,57 @@ class BSGOptionContainer {
     }
   }
 
-  static void ParseCmdLineOptions(int, char**);
-  static void ParseConfigOptions(std::string);
-  static void ParseInputOptions(std::string);
+  void ParseCmdLineOptions(int, char**);
+  void ParseConfigOptions(std::string);
+  void ParseInputOptions(std::string);
+  void ParseValues(const OptionValues&);
 
-  inline static void ClearVariablesMap() {
+  inline void ClearVariablesMap() {
      vm.clear();
    };
+
+  /**
+   * Command line tokens of all options but those in exclude, e.g. to pass the
+   * options of a process running several calculations on to each of them.
+   * Unregistered options are kept, as they may be known to NME.
+   *
+   * @param argc number of command line arguments
+   * @param argv the command line
+   * @param exclude names of the options to leave out
+   */
+  std::vector<std::string> GetArguments(int argc, char** argv, const std::set<std::string>& exclude);
+
+  /**
+   * Snapshot of the options, to be passed to the objects of a calculation
+   */
+  inline BSGOptions GetOptions() const { return BSGOptions(vm, nmeOptions); };
+
   /**
    * Check whether an options was given
    *
    * @param name variable name
    */
   bool Exists(std::string name) { return (bool)vm.count(name); }
-  inline static po::options_description GetGenericOptions() {
+  inline po::options_description GetGenericOptions() {
     return genericOptions;
   };
-  inline static po::options_description GetSpectrumOptions() {
+  inline po::options_description GetSpectrumOptions() {
     return spectrumOptions;
   };
-  inline static po::options_description GetConfigOptions() {
+  inline po::options_description GetConfigOptions() {
     return configOptions;
   };
-  inline static po::options_description GetTransitionOptions() {
+  inline po::options_description GetTransitionOptions() {
     return transitionOptions;
   };
 
  private:
-  static po::variables_map vm;
-  static po::options_description genericOptions;
-  static po::options_description spectrumOptions;
-  static po::options_description configOptions;
-  static po::options_description transitionOptions;
-  BSGOptionContainer(int, char**);
+  po::variables_map vm;
+  nme::NMEOptions nmeOptions;
+  po::options_description genericOptions;
+  po::options_description spectrumOptions;
+  po::options_description configOptions;
+  po::options_description transitionOptions;
   BSGOptionContainer(BSGOptionContainer const& copy);
   BSGOptionContainer& operator=(BSGOptionContainer const& copy);
 };
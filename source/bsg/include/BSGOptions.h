@@ -0,0 +1,85 @@
+#ifndef BSG_OPTIONS
+#define BSG_OPTIONS
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <boost/program_options/variables_map.hpp>
+
+#include "NMEOptions.h"
+
+namespace bsg {
+
+using nme::OptionValues;
+
+/**
+ * Immutable set of the resolved options of a single calculation, together
+ * with the options of its nuclear structure part.
+ * Copies share the same values, so that several calculations can each be
+ * given their own options and run on different threads.
+ */
+class BSGOptions {
+ public:
+  /**
+   * Empty set of options
+   */
+  BSGOptions() : vm(std::make_shared<boost::program_options::variables_map>()){};
+
+  /**
+   * @param _vm the parsed BSG options, which are copied
+   * @param _nmeOptions the options of the nuclear structure calculation
+   */
+  BSGOptions(const boost::program_options::variables_map& _vm, const nme::NMEOptions& _nmeOptions)
+      : vm(std::make_shared<boost::program_options::variables_map>(_vm)), nmeOptions(_nmeOptions){};
+
+  /**
+   * Get the value of an option
+   *
+   * @template T variable type
+   * @param name variable name
+   */
+  template <typename T>
+  T Get(std::string name) const {
+    try {
+      return (*vm)[name].as<T>();
+    } catch (boost::bad_any_cast& e) {
+      std::cerr << "BSG ERROR: Option \"" << name << "\" not defined. " << std::endl;
+      throw e;
+    }
+  }
+
+  /**
+   * Check whether an option was given
+   *
+   * @param name variable name
+   */
+  inline bool Exists(std::string name) const { return vm->count(name) > 0; };
+
+  inline const nme::NMEOptions& GetNMEOptions() const { return nmeOptions; };
+
+  /**
+   * Hash of all options that determine the calculated spectrum, i.e. all
+   * options except the names of the files they were read from and those
+   * controlling how the output is produced
+   *
+   * @returns 64-bit FNV-1a hash of the option names and values
+   */
+  std::uint64_t GetOptionsHash() const;
+
+  /**
+   * Options that determine the calculated spectrum, as hashed by GetOptionsHash
+   *
+   * @returns one name=value line per option, ordered by name
+   */
+  std::string GetOptionsString() const;
+
+ private:
+  std::shared_ptr<const boost::program_options::variables_map> vm;
+  nme::NMEOptions nmeOptions;
+};
+
+}
+
+#endif
@@ -0,0 +1,200 @@
+#ifndef BATCH
+#define BATCH
+
+#include <cstddef>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "BSGOptionContainer.h"
+#include "BSGOptions.h"
+
+namespace bsg {
+
+/**
+ * Cost of setting up the nuclear structure calculation with a (deformed)
+ * Woods-Saxon potential and of connecting the electrostatic potential to it,
+ * in units of the evaluation of one grid point
+ */
+const double BATCH_WS_COST = 2500.;
+const double BATCH_DWS_COST = 6000.;
+const double BATCH_CONNECT_COST = 2000.;
+/**
+ * Cost of a grid point relative to one without deformation when the
+ * deformation of the electrostatic potential is included
+ */
+const double BATCH_DEFORMATION_FACTOR = 1.8;
+/**
+ * Number of rows of a batch table that are read and run together. Jobs are
+ * ordered by their estimated cost within these windows only.
+ */
+const std::size_t BATCH_TABLE_WINDOW = 4096;
+
+/**
+ * Reason why the nuclei of a transition cannot be connected by its process,
+ * or an empty string. Such a calculation should not be started in a process
+ * that runs others, as it can crash the nuclear structure part.
+ *
+ * @param options the options of the calculation
+ */
+std::string CheckTransition(const BSGOptions& options);
+
+/**
+ * Estimate the run time of a calculation in units of the evaluation of one
+ * grid point, from the size of its grid and the corrections and nuclear
+ * potential it uses. Only the order of the estimates matters.
+ *
+ * @param options the options of the calculation
+ */
+double EstimateCost(const BSGOptions& options);
+
+/**
+ * Split a line of a batch table into its cells. Unquoted cells are trimmed,
+ * and a double quote within a quoted cell is written as two.
+ *
+ * @param line the line, without its end of line
+ * @param delimiter the delimiter, e.g. ',' for CSV or '\t' for TSV
+ * @param cells vector to be filled with the cells
+ * @returns false when a quote is not closed
+ */
+bool SplitRow(const std::string& line, char delimiter, std::vector<std::string>& cells);
+
+/**
+ * Calculation listed in a batch manifest
+ */
+struct BatchJob {
+  std::string input; /**< transition input file, or the table it was read from */
+  int line; /**< line in the table, 0 for a job of a manifest */
+  OptionValues values; /**< option values of the table row, released once parsed */
+  std::string config; /**< configuration file, empty for none */
+  std::string output; /**< output name */
+  double cost; /**< estimated run time, see EstimateCost */
+  std::string status; /**< done, cached or the reason it failed */
+  double seconds; /**< wall time */
+};
+
+/**
+ * Runs many calculations in a single process, so that the start-up is paid
+ * only once. The calculations are listed in a manifest or given by the rows
+ * of a table, which is read BATCH_TABLE_WINDOW rows at a time.
+ * The jobs are distributed over the workers before they start, the most
+ * expensive first and each to the worker with the least work so far. Every
+ * worker runs its own queue from the most expensive job down, and a worker
+ * whose queue is empty takes the cheapest job from the queue with the most
+ * remaining work, so that an underestimated job does not leave the other
+ * workers idle.
+ */
+class BatchRunner {
+ public:
+  /**
+   * @param argc number of command line arguments
+   * @param argv command line of the batch, whose options apply to every job
+   * @param container the options parsed from that command line
+   */
+  BatchRunner(int argc, char** argv, BSGOptionContainer& container);
+
+  /**
+   * Read the jobs from a manifest. Every line names an input file, optionally
+   * followed by a configuration file and an output name. A configuration
+   * file of - means the one given on the command line, and the output name
+   * defaults to the name of the input file without its extension. Empty
+   * lines and lines starting with # are skipped.
+   *
+   * @param fileName name of the manifest
+   * @returns false when the manifest cannot be read, see GetError()
+   */
+  bool ReadManifest(std::string fileName);
+
+  /**
+   * Open a CSV or TSV table with one job per row. The first line that is not
+   * empty or a comment names the options in its columns, e.g. Mother.Z or
+   * Spectrum.Begin, and the delimiter: a tab if it contains one, a comma
+   * otherwise. Cells may be quoted with double quotes. An empty cell leaves
+   * the option unset for that row. The column named output gives the output
+   * names, which default to the name of the table without its extension
+   * followed by the row number. The rows are read while the jobs are run.
+   *
+   * @param fileName name of the table
+   * @returns false when the header cannot be read, see GetError()
+   */
+  bool OpenTable(std::string fileName);
+
+  /**
+   * Run all jobs and write a report with one line per job to reportName.batch
+   *
+   * @param nWorkers number of jobs run at the same time
+   * @param reportName name of the report without its extension
+   * @returns the number of jobs that failed
+   */
+  int Run(int nWorkers, std::string reportName);
+
+  /**
+   * Number of jobs run by the last call to Run
+   */
+  inline std::size_t GetNumberOfJobs() const { return nJobs; };
+
+  /**
+   * Reason why the last operation failed, empty otherwise
+   */
+  inline const std::string& GetError() const { return error; };
+
+ private:
+  /**
+   * Queue of job indices of a single worker
+   */
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::size_t> jobs;
+    double cost = 0.; /**< estimated cost of the jobs still in the queue */
+  };
+
+  /**
+   * Read the next rows of the table into jobs
+   *
+   * @param maxRows the most rows to read
+   * @returns false when the end of the table was reached
+   */
+  bool ReadRows(std::size_t maxRows);
+
+  /**
+   * Parse the options of the current jobs and run them
+   */
+  void RunJobs(int nWorkers);
+
+  /**
+   * Command line of a job: that of the batch with its own files and output name
+   */
+  std::vector<std::string> GetArguments(const BatchJob& job) const;
+
+  /**
+   * Take the next job of a worker, or one of another worker when its own queue is empty
+   *
+   * @returns false when no jobs are left
+   */
+  bool NextJob(std::vector<Queue>& queues, std::size_t worker, std::size_t& job);
+
+  void RunJob(BatchJob& job, const BSGOptions& options);
+
+  void WriteReport(std::ostream& report) const;
+
+  std::string program;
+  std::vector<std::string> sharedArguments; /**< options of the batch that apply to every job */
+  std::string config; /**< configuration file given on the command line */
+  std::vector<BatchJob> jobs; /**< all jobs of a manifest, or the current window of a table */
+  std::ifstream table;
+  std::string tableName;
+  std::string tableStem; /**< name of the table without directory and extension */
+  char delimiter;
+  std::vector<std::string> columns; /**< option names of the table columns */
+  int tableLine; /**< number of lines of the table read so far */
+  int tableRow; /**< number of rows read so far */
+  std::size_t nJobs;
+  bool cacheReported; /**< whether the use of the result cache has been logged */
+  std::string error;
+};
+
+}
+
+#endif  // BATCH
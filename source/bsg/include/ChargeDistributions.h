@@ -362,6 +362,8 @@ inline double GetDerivDeformedChargeDist(double r, double a, double b) {
 /**
  * Fit the charge distribution as constructed using Harmonic Oscillator functions
  * to a Modified Gaussian distribution using ROOT.
+ * The fit function is registered by name in a global list of ROOT, so
+ * calculations on different threads take turns.
  *
  * @param Z the proton number of the nucleus
  * @param rms the nuclear RMS radius
@@ -370,6 +372,7 @@ inline double GetDerivDeformedChargeDist(double r, double a, double b) {
  * @see ChargeMG_f
  */
 inline double FitHODist(int Z, double rms) {
+  std::lock_guard<std::mutex> lock(utilities::GetRootMutex());
   //auto start = std::chrono::steady_clock::now();
   TF1* funcMG = new TF1("ChargeMG", ChargeMG_f, 0, 5 * rms, 2);
   funcMG->SetParameters(5.0, std::sqrt(5. / 3.) * rms);
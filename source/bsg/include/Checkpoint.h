@@ -0,0 +1,134 @@
+#ifndef CHECKPOINT
+#define CHECKPOINT
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "Spectrum.h"
+#include "SpectrumSink.h"
+
+namespace bsg {
+
+/**
+ * Magic string at the start of every header slot of a checkpoint file
+ */
+const char CHECKPOINT_MAGIC[8] = {'B', 'S', 'G', 'C', 'K', 'P', 'T', '\0'};
+/**
+ * Version of the checkpoint file layout, increased for incompatible changes
+ */
+const std::uint32_t CHECKPOINT_VERSION = 1;
+/**
+ * Size in bytes of each of the two header slots
+ */
+const std::uint64_t CHECKPOINT_SLOT_SIZE = 256;
+/**
+ * Byte offset of the first point, after both header slots
+ */
+const std::uint64_t CHECKPOINT_DATA_OFFSET = 2 * CHECKPOINT_SLOT_SIZE;
+
+/**
+ * Header describing the completed part of a calculation
+ */
+struct CheckpointHeader {
+  char magic[8]; /**< CHECKPOINT_MAGIC */
+  std::uint32_t version; /**< CHECKPOINT_VERSION */
+  std::uint32_t byteOrder; /**< SPECTRUM_FILE_BYTE_ORDER in the byte order of the writer */
+  std::uint64_t sequence; /**< number of times the header was written, the newest slot wins */
+  std::uint64_t optionsHash; /**< hash of the options that determine the spectrum */
+  std::uint64_t nTotal; /**< number of points of the complete grid */
+  std::uint64_t nDone; /**< number of points that are completed and on disk */
+  SpectrumMoments::State moments; /**< integrals accumulated over the completed points */
+  std::uint64_t checksum; /**< hash of all preceding bytes, to detect a torn write */
+};
+
+static_assert(sizeof(CheckpointHeader) <= CHECKPOINT_SLOT_SIZE,
+              "Checkpoint header does not fit in its slot");
+
+/**
+ * Checkpoint of a spectrum calculation, so that a process that is killed
+ * can continue from the last completed block instead of starting over.
+ * The file starts with two header slots, followed by the completed points
+ * as rows of W, electron and neutrino decay rate. Points are appended as
+ * they are calculated, but only count once a header referring to them is
+ * written by Commit. The headers are written alternately to both slots,
+ * so that a crash while writing one leaves the previous one intact.
+ */
+class Checkpoint {
+ public:
+  /**
+   * @param fileName name of the checkpoint file
+   */
+  Checkpoint(std::string fileName);
+
+  ~Checkpoint();
+
+  Checkpoint(const Checkpoint&) = delete;
+  Checkpoint& operator=(const Checkpoint&) = delete;
+
+  /**
+   * Start an empty checkpoint, replacing an existing file
+   *
+   * @param optionsHash hash of the options that determine the spectrum
+   * @param nTotal number of points of the complete grid
+   * @returns true when the file could be created
+   */
+  bool Create(std::uint64_t optionsHash, std::uint64_t nTotal);
+
+  /**
+   * Open an existing checkpoint and read the completed points, after which
+   * new points are appended to it
+   *
+   * @param optionsHash hash of the options of the current calculation, which must match the checkpoint
+   * @param nTotal number of points of the complete grid, which must match the checkpoint
+   * @param prefix spectrum filled with the completed points
+   * @param moments integrals accumulated over the completed points
+   * @returns true when the checkpoint was read, otherwise see GetError()
+   */
+  bool Resume(std::uint64_t optionsHash, std::uint64_t nTotal, Spectrum& prefix,
+              SpectrumMoments::State& moments);
+
+  /**
+   * Append calculated points, which are not part of the checkpoint until the next Commit
+   */
+  bool Append(const double W[], const double electron[], const double neutrino[], std::size_t size);
+
+  /**
+   * Make all appended points part of the checkpoint. Returns after the data
+   * is on disk.
+   *
+   * @param moments integrals accumulated over all appended points
+   */
+  bool Commit(const SpectrumMoments::State& moments);
+
+  /**
+   * Close and delete the file, once the calculation has finished
+   */
+  void Remove();
+
+  inline bool IsOpen() const { return file != nullptr; };
+
+  /**
+   * Reason why the last operation failed, empty otherwise
+   */
+  inline const std::string& GetError() const { return error; };
+
+  /**
+   * Number of completed points in the checkpoint
+   */
+  inline std::uint64_t GetDone() const { return header.nDone; };
+
+ private:
+  void Close();
+  bool WriteHeader();
+
+  std::string fileName;
+  std::FILE* file; /**< the open checkpoint file, nullptr when closed */
+  CheckpointHeader header; /**< header of the last Commit */
+  std::uint64_t nAppended; /**< number of points in the file, including those not yet committed */
+  std::string error;
+};
+
+}
+
+#endif  // CHECKPOINT
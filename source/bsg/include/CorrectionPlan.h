@@ -0,0 +1,183 @@
+#ifndef CORRECTIONPLAN
+#define CORRECTIONPLAN
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace bsg {
+
+/**
+ * Function filling an output array with a correction factor for each entry of an input array of energies
+ */
+typedef std::function<void(const double*, double*, int)> BatchCorrection;
+
+/**
+ * A single spectral correction with all of its W-independent parameters bound
+ */
+struct CorrectionKernel {
+  std::string name; /**< name of the correction, equal to the suffix of its Spectrum.* option */
+  std::function<double(double)> electron; /**< correction factor as a function of the electron total energy */
+  std::function<double(double)> neutrino; /**< correction factor as a function of the neutrino total energy */
+  BatchCorrection electronBatch; /**< optional array version of electron, empty if not available */
+  BatchCorrection neutrinoBatch; /**< optional array version of neutrino, empty if not available */
+  bool symmetric; /**< whether electron and neutrino are the same function */
+};
+
+/**
+ * Ordered list of the spectral corrections that are enabled for a transition.
+ * It is built once, after which the decay rate at any energy is obtained by
+ * running through the kernels without consulting the options again.
+ */
+class CorrectionPlan {
+ public:
+  /**
+   * Append a correction to the plan
+   *
+   * @param name name of the correction
+   * @param electron correction factor as a function of the electron total energy
+   * @param neutrino correction factor as a function of the neutrino total energy
+   */
+  inline void Add(std::string name, std::function<double(double)> electron,
+                  std::function<double(double)> neutrino) {
+    kernels.push_back({name, electron, neutrino, nullptr, nullptr, false});
+  };
+
+  /**
+   * Append a correction with the same form for electron and neutrino
+   *
+   * @param name name of the correction
+   * @param f correction factor as a function of the total energy of either lepton
+   * @param fBatch array version of f, or nullptr if not available
+   */
+  inline void AddSymmetric(std::string name, std::function<double(double)> f,
+                           BatchCorrection fBatch) {
+    kernels.push_back({name, f, f, fBatch, fBatch, true});
+  };
+
+  /**
+   * Append a correction to the plan that can also be evaluated on arrays of energies
+   *
+   * @param name name of the correction
+   * @param electron correction factor as a function of the electron total energy
+   * @param neutrino correction factor as a function of the neutrino total energy
+   * @param electronBatch array version of electron
+   * @param neutrinoBatch array version of neutrino
+   */
+  inline void Add(std::string name, std::function<double(double)> electron,
+                  std::function<double(double)> neutrino,
+                  BatchCorrection electronBatch, BatchCorrection neutrinoBatch) {
+    kernels.push_back({name, electron, neutrino, electronBatch, neutrinoBatch, false});
+  };
+
+  /**
+   * Multiply all correction factors in the order in which they were added
+   *
+   * @param W the electron total energy in units of its rest mass
+   * @param Wv the neutrino total energy in units of the electron rest mass
+   * @returns the electron and neutrino decay rates
+   */
+  inline std::tuple<double, double> Evaluate(double W, double Wv) const {
+    double result = 1.;
+    double neutrinoResult = 1.;
+    for (const auto& k : kernels) {
+      result *= k.electron(W);
+      neutrinoResult *= k.neutrino(Wv);
+    }
+    return std::make_tuple(result, neutrinoResult);
+  };
+
+  /**
+   * Evaluate the plan on arrays of energies, one correction at a time.
+   * Corrections without an array version fall back to their scalar function.
+   * The products are formed in the same order as in Evaluate, but the array versions of
+   * several corrections, e.g. L0, Recoil and C, rearrange their arithmetic, so both agree
+   * to rounding rather than in every bit.
+   *
+   * @param W array of electron total energies in units of its rest mass
+   * @param Wv array of the corresponding neutrino total energies
+   * @param electron output array for the electron decay rates
+   * @param neutrino output array for the neutrino decay rates
+   * @param size number of energies
+   * @param seconds if not nullptr, the time spent in each correction is added to it, see Multiply
+   */
+  inline void EvaluateBatch(const double W[], const double Wv[], double electron[],
+                            double neutrino[], int size, double seconds[] = nullptr) const {
+    std::fill(electron, electron + size, 1.);
+    std::fill(neutrino, neutrino + size, 1.);
+    Multiply(W, electron, size, false, ALL, seconds);
+    Multiply(Wv, neutrino, size, true, ALL, seconds);
+  };
+
+  /**
+   * Selects a subset of the corrections in the plan
+   */
+  enum Selection {
+    ALL, /**< all corrections */
+    SYMMETRIC, /**< only the corrections with the same form for electron and neutrino */
+    ASYMMETRIC /**< only the corrections with a different form for electron and neutrino */
+  };
+
+  /**
+   * Multiply an array with the product of a subset of the corrections, one correction at a time
+   *
+   * @param W array of total energies of the lepton in units of the electron rest mass
+   * @param result array that is multiplied in place
+   * @param size number of energies
+   * @param neutrino whether to use the neutrino rather than the electron form of the corrections
+   * @param selection the subset of corrections to apply
+   * @param seconds if not nullptr, the wall time spent in each correction is added to it,
+   * with one entry per kernel in the order of GetKernels()
+   */
+  inline void Multiply(const double W[], double result[], int size, bool neutrino,
+                       Selection selection, double seconds[] = nullptr) const {
+    std::vector<double> buffer(size);
+    for (std::size_t j = 0; j < kernels.size(); j++) {
+      const CorrectionKernel& k = kernels[j];
+      if ((selection == SYMMETRIC && !k.symmetric) || (selection == ASYMMETRIC && k.symmetric)) {
+        continue;
+      }
+      EvaluateKernel(j, W, buffer.data(), size, neutrino, seconds);
+      for (int i = 0; i < size; i++) result[i] *= buffer[i];
+    }
+  };
+
+  /**
+   * Evaluate a single correction on an array of energies
+   *
+   * @param j index of the correction in GetKernels()
+   * @param W array of total energies of the lepton in units of the electron rest mass
+   * @param result output array for the correction factors
+   * @param size number of energies
+   * @param neutrino whether to use the neutrino rather than the electron form of the correction
+   * @param seconds if not nullptr, the wall time spent is added to seconds[j]
+   */
+  inline void EvaluateKernel(std::size_t j, const double W[], double result[], int size,
+                             bool neutrino, double seconds[] = nullptr) const {
+    const CorrectionKernel& k = kernels[j];
+    std::chrono::steady_clock::time_point start;
+    if (seconds) start = std::chrono::steady_clock::now();
+    const BatchCorrection& batch = neutrino ? k.neutrinoBatch : k.electronBatch;
+    const std::function<double(double)>& f = neutrino ? k.neutrino : k.electron;
+    if (batch) {
+      batch(W, result, size);
+    } else {
+      for (int i = 0; i < size; i++) result[i] = f(W[i]);
+    }
+    if (seconds) {
+      seconds[j] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+  };
+
+  inline const std::vector<CorrectionKernel>& GetKernels() const { return kernels; };
+
+ private:
+  std::vector<CorrectionKernel> kernels; /**< enabled corrections in order of application */
+};
+
+}
+
+#endif  // CORRECTIONPLAN
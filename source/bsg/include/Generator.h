@@ -1,15 +1,35 @@
 #ifndef GENERATOR
 #define GENERATOR
 
+#include <atomic>
+#include <functional>
+#include <set>
+#include <stdexcept>
 #include <vector>
 #include <string>
 #include <tuple>
+#include <utility>
 #include "NuclearStructureManager.h"
 #include "NuclearUtilities.h"
+#include "BSGOptions.h"
+#include "Checkpoint.h"
+#include "CorrectionPlan.h"
+#include "Spectrum.h"
+#include "SpectrumFile.h"
+#include "SpectrumSink.h"
+#include "Utilities.h"
 #include "spdlog/spdlog.h"
 
 namespace bsg {
 
+/**
+ * Thrown by the calculations of a Generator whose cancel flag was set
+ */
+class CalculationCancelled : public std::runtime_error {
+ public:
+  CalculationCancelled() : std::runtime_error("calculation cancelled"){};
+};
+
 class Generator {
  private:
   /**
@@ -46,9 +66,28 @@ class Generator {
 
   nme::NuclearStructure::SingleParticleState spsi, spsf; /**< single particle states calculated from the NME library and used in the C_I correction when turned on */
 
+  const BSGOptions options; /**< the options of the transition */
+
   nme::NuclearStructure::NuclearStructureManager* nsm; /**< pointer to the nuclear structure manager */
 
-  std::vector<std::vector<double> >* spectrum; /**< vector of vectors containing the calculated spectrum */
+  Spectrum spectrum; /**< the calculated spectrum, empty when streaming */
+  SpectrumMoments moments; /**< integrals of the calculated spectrum */
+  bool streaming = false; /**< whether the spectrum is only written to file and not kept in memory */
+  std::string gridKind; /**< "regular", "symmetric" or "list" grid of the last spectrum */
+  double gridFirstW = 0.; /**< first energy of the grid of the last spectrum */
+  double gridLastW = 0.; /**< last energy of the grid of the last spectrum */
+  double gridStepW = 0.; /**< step of the grid of the last spectrum, 0 for a list */
+
+  CorrectionPlan plan; /**< the enabled spectral corrections with all W-independent parameters bound */
+
+  std::string outputError; /**< first error writing an output file */
+  std::vector<std::string> outputFiles; /**< extensions of the output files written by this Generator */
+  std::vector<std::pair<std::string, double> > phaseTimes; /**< wall time in seconds spent in each phase of the calculation */
+  std::vector<double> correctionTimes; /**< wall time in seconds spent in each correction of plan, summed over threads */
+  std::size_t nPoints = 0; /**< number of points of the last calculated spectrum */
+
+  utilities::MonotoneSpline deformationSpline; /**< interpolated deformation correction when Spectrum.ESDeformationTolerance is set */
+  double deformationError = 0.; /**< largest relative error of deformationSpline at the midpoints of its intervals */
 
   /// recoil correction form factors
   double fb, fc1, fd, ratioM121;
@@ -57,11 +96,12 @@ class Generator {
 
   std::shared_ptr<spdlog::logger> consoleLogger;
   std::shared_ptr<spdlog::logger> debugFileLogger;
-  std::shared_ptr<spdlog::logger> rawSpectrumLogger;
   std::shared_ptr<spdlog::logger> resultsFileLogger;
 
   std::string outputName;
 
+  const std::atomic<bool>* cancelFlag = nullptr; /**< set from another thread to stop the calculation */
+
   /**
    * Calculate the required nuclear matrix elements if they are not given from the commandline
    */
@@ -91,16 +131,40 @@ class Generator {
    */
   void InitializeLoggers();
 
+  /**
+   * Record that the output file with an extension was written by this Generator
+   *
+   * @param extension extension of the file named after the output option, e.g. "json"
+   */
+  void AddOutputFile(const std::string& extension);
+
   /**
    * Initialize all Nuclear structure manager-related stuff, like single particle states when C_I and NME are connected, and calculating the required matrix elements
    */
   void InitializeNSMInfo();
 
+  /**
+   * Resolve the spectral options once and build the list of enabled corrections
+   */
+  void InitializeCorrectionPlan();
+
   /**
    * Construct the output file
    */
   void PrepareOutputFile();
 
+  /**
+   * Fill the header of a binary spectrum file or stream with the transition data
+   *
+   * @param nPoints number of grid points
+   */
+  SpectrumFileHeader GetFileHeader(std::size_t nPoints);
+
+  /**
+   * Write the results, the enabled corrections and the timings to a JSON file
+   */
+  void WriteJsonSummary();
+
   /**
    * Calculate the properly normalized ft value
    * @param partialHalflife the halflife of the transition
@@ -109,6 +173,107 @@ class Generator {
 
   double CalculateMeanEnergy();
 
+  /**
+   * Check whether the spectrum can be calculated on a grid that is symmetric
+   * under the exchange of electron and neutrino energies
+   *
+   * @returns true if Spectrum.SymmetricGrid is turned on and can be honoured
+   */
+  bool UseSymmetricGrid();
+
+  /**
+   * Construct the grid of total electron energies on which the spectrum is evaluated
+   *
+   * @param symmetric if true, construct equidistant nodes for which @f$ W_0 - W + 1 @f$ is again a node
+   * @returns generator of W values in ascending order
+   */
+  EnergyGrid GetEnergyGrid(bool symmetric);
+
+  /**
+   * Continue from the checkpoint of a previous run when --resume is given, or start a new one.
+   * On success the grid is advanced past the completed points, which are pushed to the sinks
+   * again, and the accumulated integrals are restored.
+   *
+   * @param checkpoint the checkpoint, which is left open for the points still to be calculated
+   * @param grid the energy grid of the current calculation
+   * @param sinks the sinks receiving the spectrum, including moments
+   */
+  void ResumeCheckpoint(Checkpoint& checkpoint, EnergyGrid& grid, const std::vector<SpectrumSink*>& sinks);
+
+  /**
+   * Run a function on consecutive chunks of GRID_CHUNK_SIZE indices, possibly using several threads.
+   * The time spent in each correction is added to correctionTimes.
+   *
+   * @param size number of indices
+   * @param nThreads the number of threads to use
+   * @param f function called with the first and one past the last index of a chunk, and an
+   * array of per-correction timings belonging to the calling thread
+   */
+  void ForEachChunk(std::size_t size, int nThreads,
+                    const std::function<void(std::size_t, std::size_t, double*)>& f);
+
+  /**
+   * Evaluate the decay rate on all points of an energy grid, possibly using several threads.
+   * The grid is split into chunks of consecutive indices, and results are stored in grid order
+   * so that the outcome does not depend on the number of threads.
+   *
+   * @param grid vector of total electron energies
+   * @param electron vector to be filled with the electron decay rates
+   * @param neutrino vector to be filled with the neutrino decay rates
+   * @param nThreads the number of threads to use
+   * @param symmetric if true, the grid was made by GetEnergyGrid(true) and the corrections that are the
+   * same for electron and neutrino are evaluated only once per node
+   */
+  void EvaluateEnergyGrid(const std::vector<double>& grid, std::vector<double>& electron,
+                          std::vector<double>& neutrino, int nThreads, bool symmetric);
+
+  /**
+   * Evaluate every correction separately on the grid points of spectrum, storing the factors in
+   * the columns named by Spectrum::ElectronColumn and Spectrum::NeutrinoColumn, and their product
+   * as the decay rates. The factors are multiplied in the order of the plan. That is also the
+   * order of EvaluateEnergyGrid on a regular grid. On a symmetric grid, EvaluateEnergyGrid
+   * multiplies the product of the shared corrections by that of the others instead, so the
+   * decay rates agree with it to rounding.
+   *
+   * @param grid the total electron energies of spectrum
+   * @param nThreads the number of threads to use
+   * @param symmetric if true, the grid was made by GetEnergyGrid(true) and the neutrino factors
+   * of the corrections that are the same for electron and neutrino are not evaluated again
+   */
+  void EvaluateBreakdown(const std::vector<double>& grid, int nThreads, bool symmetric);
+
+  /**
+   * Write the per-correction factors to a text file
+   */
+  void WriteBreakdown();
+
+  /**
+   * Integrate the spectrum over the bins given by Spectrum.BinEdges and write the result to a text file
+   *
+   * @param nThreads the number of threads to use
+   */
+  void WriteBinIntegrals(int nThreads);
+
+  /**
+   * Calculate the decay rate at energy W without writing it to the raw spectrum file
+   *
+   * @param W the total electron energy in units of its rest mass
+   * @returns the electron and neutrino decay rates at energy W
+   */
+  std::tuple<double, double> EvaluateDecayRate(double W);
+
+  /**
+   * Calculate the decay rates for an array of energies, evaluating one correction at a time
+   *
+   * @param W array of total electron energies in units of its rest mass
+   * @param electron output array for the electron decay rates
+   * @param neutrino output array for the neutrino decay rates
+   * @param size number of energies
+   * @param seconds if not nullptr, the time spent in each correction is added to it
+   */
+  void EvaluateDecayRates(const double W[], double electron[], double neutrino[], int size,
+                          double seconds[] = nullptr);
+
  public:
   /**
    * Constructor for Generator.
@@ -116,27 +281,107 @@ class Generator {
    * from the commandline or config file, performing the L0 initialization and charge distribution fitting
    */
   Generator();
+  /**
+   * Constructor for Generator with the options of a single transition.
+   * The Generator does not use the BSGOptionContainer singleton and writes
+   * to its own loggers, so that several of them can be used at the same
+   * time, also on different threads, as long as their output names differ.
+   *
+   * @param options the options of the transition
+   */
+  Generator(const BSGOptions& options);
   /**
    * Destructor for Generator.
    * Deletes the reference to the nuclear structure manager
    */
   ~Generator();
 
+  // the corrections of plan refer to this Generator, so a copy would calculate with the original
+  Generator(const Generator&) = delete;
+  Generator& operator=(const Generator&) = delete;
+
   /**
    * Calculates the beta spectrum by filling the spectrum variable.
+   * With the stream option, the points are only passed on to the output and
+   * to the integrals, and the spectrum variable is left empty.
    *
    * @returns spectrum variable
    */
-  std::vector<std::vector<double> >* CalculateSpectrum();
+  const Spectrum& CalculateSpectrum();
+
+  inline const Spectrum& GetSpectrum() const { return spectrum; };
+
   /**
-   * Calculate the decay rate at energy W
+   * Reason why an output file of the last CalculateSpectrum could not be
+   * written completely, e.g. because the disk is full, empty otherwise
+   */
+  inline const std::string& GetOutputError() const { return outputError; };
+
+  /**
+   * Extensions of the output files named after the output option that were
+   * written by this Generator, as opposed to files left by earlier runs
+   */
+  inline const std::vector<std::string>& GetOutputFiles() const { return outputFiles; };
+
+  /**
+   * Hand over the calculated spectrum without copying it, e.g. to keep it
+   * when the Generator calculates again or is deleted. The Generator is left
+   * with an empty spectrum, so Recompose can no longer be used.
+   *
+   * @returns the calculated spectrum
+   */
+  inline Spectrum ReleaseSpectrum() {
+    Spectrum released;
+    std::swap(released, spectrum);
+    return released;
+  };
+
+  /**
+   * Recompose the spectrum with some corrections turned off, using the factors stored
+   * by the breakdown option instead of evaluating the corrections again
+   *
+   * @param disabled names of the corrections to leave out, as in their Spectrum.* option
+   * @returns spectrum on the same grid, without additional columns
+   * @throws std::invalid_argument when the spectrum was not calculated with the breakdown
+   * option, or has been handed over by ReleaseSpectrum
+   */
+  Spectrum Recompose(const std::set<std::string>& disabled) const;
+  /**
+   * Calculate the decay rate at energy W. Unlike CalculateSpectrum, nothing is
+   * written to the output files, so that it can be called for many points.
    *
    * @param W the total electron energy in units of its rest mass
    * @returns the decay rate at energy W
    */
   std::tuple<double, double> CalculateDecayRate(double W);
 
+  /**
+   * Integrate the electron and neutrino spectra over bins of kinetic energy using
+   * Gauss-Legendre quadrature in every bin, after a change of variables that removes
+   * the square root behaviour at both ends of the spectrum. Parts of bins outside of
+   * the allowed energy range do not contribute.
+   *
+   * @param edges ascending bin edges in keV
+   * @param order number of Gauss-Legendre nodes per bin
+   * @param electron vector to be filled with the integral of the electron decay rate over W for every bin
+   * @param neutrino vector to be filled with the same for the neutrino decay rate
+   * @param nThreads the number of threads to use
+   */
+  void CalculateBinIntegrals(const std::vector<double>& edges, int order, std::vector<double>& electron,
+                             std::vector<double>& neutrino, int nThreads = 1);
+
   inline void SetOutputName(std::string _output) { outputName = _output; };
+
+  /**
+   * Stop the calculations on the energy grid, which throw CalculationCancelled,
+   * as soon as flag is set, e.g. from another thread. The flag is checked
+   * before every chunk of grid points.
+   *
+   * @param flag the flag, which must outlive the calculations, or nullptr
+   */
+  inline void SetCancelFlag(const std::atomic<bool>* flag) { cancelFlag = flag; };
+
+  inline const CorrectionPlan& GetCorrectionPlan() const { return plan; };
 };
 
 }
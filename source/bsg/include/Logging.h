@@ -0,0 +1,111 @@
+#ifndef BSG_LOGGING
+#define BSG_LOGGING
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "spdlog/spdlog.h"
+#include "spdlog/async.h"
+#include "spdlog/sinks/basic_file_sink.h"
+#include "spdlog/sinks/null_sink.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+namespace bsg {
+
+namespace logging {
+
+/**
+ * Number of messages the debugging loggers can hold before the calling thread has to wait
+ */
+const std::size_t ASYNC_QUEUE_SIZE = 8192;
+
+/**
+ * Loggers of a single calculation, handed to the free functions that report on it
+ */
+struct Loggers {
+  std::shared_ptr<spdlog::logger> console; /**< warnings and errors for the user */
+  std::shared_ptr<spdlog::logger> debug; /**< debugging information for the log file */
+  std::shared_ptr<spdlog::logger> results; /**< results for the human readable output file */
+};
+
+/**
+ * Mutex guarding the creation of loggers shared by all calculations
+ */
+inline std::mutex& GetLoggerMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+/**
+ * Create a debugging logger for a single calculation.
+ * The logger is not registered with spdlog, so that several calculations
+ * can each write to their own file. Messages below the given level are
+ * discarded before their arguments are formatted. The others are written
+ * to the file by a background thread, so that the calculation does not
+ * wait for the disk.
+ *
+ * @param fileName name of the log file
+ * @param level lowest level written: trace, debug, info, warning, error, critical or off
+ * @param toFile if false, no file is created and all messages are discarded
+ * @returns the new logger
+ */
+inline std::shared_ptr<spdlog::logger> CreateDebugFileLogger(std::string fileName, std::string level,
+                                                             bool toFile) {
+  std::shared_ptr<spdlog::logger> logger;
+  if (!toFile) {
+    logger = std::make_shared<spdlog::logger>("debug_file", std::make_shared<spdlog::sinks::null_sink_mt>());
+    logger->set_level(spdlog::level::off);
+    return logger;
+  }
+  {
+    std::lock_guard<std::mutex> lock(GetLoggerMutex());
+    if (!spdlog::thread_pool()) {
+      spdlog::init_thread_pool(ASYNC_QUEUE_SIZE, 1);
+    }
+  }
+  // blocks instead of dropping messages when the queue is full
+  logger = std::make_shared<spdlog::async_logger>(
+      "debug_file", std::make_shared<spdlog::sinks::basic_file_sink_mt>(fileName), spdlog::thread_pool(),
+      spdlog::async_overflow_policy::block);
+  logger->set_level(spdlog::level::from_str(level));
+  logger->flush_on(spdlog::level::err);
+  return logger;
+}
+
+/**
+ * Create a logger writing the plain messages to a file, for a single calculation
+ *
+ * @param name name of the logger
+ * @param fileName name of the file, which is truncated
+ */
+inline std::shared_ptr<spdlog::logger> CreateFileLogger(std::string name, std::string fileName) {
+  auto logger = std::make_shared<spdlog::logger>(name, std::make_shared<spdlog::sinks::basic_file_sink_mt>(fileName, true));
+  logger->set_pattern("%v");
+  logger->set_level(spdlog::level::info);
+  return logger;
+}
+
+/**
+ * Get the console logger shared by all calculations in the process,
+ * creating it when it does not exist yet
+ *
+ * @param toStderr if true, a new logger writes to standard error instead of standard output
+ * @param pattern spdlog pattern of a new logger
+ * @returns the logger registered as "console"
+ */
+inline std::shared_ptr<spdlog::logger> GetConsoleLogger(bool toStderr, std::string pattern = "%+") {
+  std::lock_guard<std::mutex> lock(GetLoggerMutex());
+  auto logger = spdlog::get("console");
+  if (!logger) {
+    logger = toStderr ? spdlog::stderr_color_mt("console") : spdlog::stdout_color_mt("console");
+    logger->set_pattern(pattern);
+    logger->set_level(spdlog::level::warn);
+  }
+  return logger;
+}
+
+}
+}
+
+#endif  // BSG_LOGGING
@@ -0,0 +1,96 @@
+#ifndef RESULTCACHE
+#define RESULTCACHE
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BSGOptions.h"
+
+namespace bsg {
+
+/**
+ * On-disk cache of the output files of finished calculations.
+ * Every entry is a directory named after the hash of its key, holding the
+ * full key and one file per output extension. The key contains everything
+ * the output depends on: the BSG version, the resolved options and the
+ * contents of the data files they refer to, so that a cached result is
+ * reused whenever the same calculation is requested again. The least
+ * recently used entries are removed when the cache grows beyond its size.
+ */
+class ResultCache {
+ public:
+  /**
+   * @param directory directory holding the entries, created when needed
+   * @param maxBytes size above which the least recently used entries are removed
+   */
+  ResultCache(std::string directory, std::uint64_t maxBytes);
+
+  /**
+   * Cache configured by the cache-dir, cache-size and no-cache options
+   *
+   * @param options the options of the calculation
+   * @returns a cache that is disabled when the options do not allow caching the calculation
+   */
+  static ResultCache FromOptions(const BSGOptions& options);
+
+  /**
+   * Key of the calculation described by a set of options
+   *
+   * @param options the options of the calculation
+   */
+  static std::string GetKey(const BSGOptions& options);
+
+  inline bool IsEnabled() const { return !directory.empty(); };
+
+  inline const std::string& GetDirectory() const { return directory; };
+
+  inline std::uint64_t GetMaxBytes() const { return maxBytes; };
+
+  /**
+   * Copy the files of a cached result to outputName with their extensions,
+   * removing any other output file of that name
+   *
+   * @param key key of the calculation
+   * @param outputName name of the output files
+   * @returns true on a cache hit
+   */
+  bool Fetch(const std::string& key, const std::string& outputName);
+
+  /**
+   * Add the output files of a finished calculation, and remove the least
+   * recently used entries when the cache is too large
+   *
+   * @param key key of the calculation
+   * @param outputName name of the output files
+   * @param extensions extensions of the files written by the calculation, see
+   * Generator::GetOutputFiles(), so that files left by earlier runs are not stored
+   * @returns true when the entry was added
+   */
+  bool Store(const std::string& key, const std::string& outputName, const std::vector<std::string>& extensions);
+
+  /**
+   * Remove the least recently used entries until the cache is at most maxBytes large
+   *
+   * @param keep key of an entry that is not removed, e.g. the one just added
+   */
+  void Evict(const std::string& keep = "");
+
+  /**
+   * Extensions of the output files that are kept in the cache
+   */
+  static const std::vector<std::string>& GetExtensions();
+
+ private:
+  /**
+   * Directory of the entry for a key
+   */
+  std::string GetEntry(const std::string& key) const;
+
+  std::string directory; /**< empty when the cache is disabled */
+  std::uint64_t maxBytes;
+};
+
+}
+
+#endif  // RESULTCACHE
@@ -0,0 +1,87 @@
+#ifndef ROOTSPECTRUMWRITER
+#define ROOTSPECTRUMWRITER
+
+#include <cstdint>
+#include <string>
+
+#include "SpectrumSink.h"
+
+namespace bsg {
+
+/**
+ * Summary of a calculated transition, stored once per spectrum
+ */
+struct SpectrumSummary {
+  std::string name; /**< output name of the run */
+  std::string options; /**< options that determine the spectrum, one name=value per line */
+  std::uint64_t optionsHash; /**< hash of the options */
+  double Z; /**< proton number of the daughter nucleus */
+  double A; /**< mass number */
+  double W0; /**< endpoint energy in units of the electron rest mass */
+  double QValue; /**< Q value in keV */
+  int betaType; /**< 1 for beta-, -1 for beta+ */
+  double f; /**< integral of the electron spectrum */
+  double logFt; /**< log ft value, NaN when no partial halflife is given */
+  double meanEnergy; /**< mean kinetic energy of the electron in keV */
+  double bAc; /**< weak magnetism form factor ratio b/Ac */
+  double dAc; /**< induced tensor form factor ratio d/Ac */
+  double lambda; /**< ratio of form factors AM121/AM101 */
+};
+
+/**
+ * Sink appending spectra to a ROOT file, so that many transitions can be
+ * collected in a single compressed file.
+ * The file contains two trees: "summary", with one entry per transition,
+ * and "spectrum", with one entry per grid point. The transition branch of
+ * the latter is the entry number of the corresponding summary.
+ * The points are kept in memory and the file is only opened when the writer
+ * is closed, so that calculations in the same process only take turns for
+ * the short time needed to extend the trees.
+ * Existing trees are extended, so the file should not be written by
+ * several processes at the same time.
+ */
+class RootSpectrumWriter : public SpectrumSink {
+ public:
+  /**
+   * @param fileName name of the ROOT file, created when it does not exist yet
+   */
+  RootSpectrumWriter(std::string fileName);
+
+  ~RootSpectrumWriter();
+
+  RootSpectrumWriter(const RootSpectrumWriter&) = delete;
+  RootSpectrumWriter& operator=(const RootSpectrumWriter&) = delete;
+
+  inline void Push(double W, double electron, double neutrino) {
+    points.GetW().push_back(W);
+    points.GetElectron().push_back(electron);
+    points.GetNeutrino().push_back(neutrino);
+  };
+
+  /**
+   * Set the summary of the spectrum that was pushed
+   */
+  void WriteSummary(const SpectrumSummary& summary);
+
+  /**
+   * Append the spectrum and its summary to the file, creating the file or
+   * the trees when they do not exist yet. Does nothing when already closed.
+   *
+   * @returns false when the file cannot be written, see GetError()
+   */
+  bool Close();
+
+  inline std::string GetError() const { return error; };
+
+ private:
+  std::string fileName;
+  Spectrum points; /**< points pushed so far */
+  SpectrumSummary summary;
+  bool hasSummary;
+  bool closed;
+  std::string error;
+};
+
+}
+
+#endif  // ROOTSPECTRUMWRITER
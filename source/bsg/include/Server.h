@@ -0,0 +1,197 @@
+#ifndef SERVER
+#define SERVER
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BSGOptionContainer.h"
+#include "BSGOptions.h"
+
+namespace bsg {
+
+/**
+ * Header of every message exchanged with a SpectrumServer, in native byte
+ * order, followed by size bytes of payload.
+ *
+ * A client sends
+ *  - "SPEC": calculate a spectrum. The payload holds the options of the
+ *    transition in the form of an input or configuration file, i.e. lines
+ *    "name = value" below "[Section]" headers, or lines "Section.name = value".
+ *    With flags SERVER_BATCH the request waits behind all interactive ones.
+ *  - "CNCL": cancel the request with the given id, which is answered by a
+ *    "FAIL" message unless its result was already sent. No payload.
+ *
+ * The server answers every "SPEC" request with either
+ *  - "RSLT": a 64-bit number of points n followed by the columns W,
+ *    electron and neutrino of n native doubles each.
+ *  - "FAIL": the reason as text, "cancelled" for a cancelled request.
+ *
+ * A client may send further requests before the answers arrive, which are
+ * sent as soon as they are ready and can be matched through their id.
+ */
+struct ServerMessageHeader {
+  char type[4]; /**< message type, e.g. "SPEC" */
+  std::uint32_t id; /**< request id chosen by the client, unique among its unanswered requests */
+  std::uint32_t flags; /**< SERVER_BATCH or 0 */
+  std::uint32_t size; /**< number of payload bytes */
+};
+
+/**
+ * Flag of a request that is queued behind the interactive ones
+ */
+const std::uint32_t SERVER_BATCH = 1;
+/**
+ * Largest accepted payload; a client sending more is disconnected
+ */
+const std::uint32_t SERVER_MAX_PAYLOAD = 1 << 20;
+
+/**
+ * Answers spectrum requests over a Unix domain socket, see ServerMessageHeader.
+ * As the server keeps running between requests, everything that is shared
+ * between calculations, such as ROOT, the exchange parameters and the charge
+ * distribution fits, is set up only once.
+ *
+ * Requests are calculated by a pool of workers. Interactive requests are
+ * taken before batch requests, and with more than one worker, one of them
+ * only takes interactive requests, so that these never wait for a long batch
+ * calculation to finish.
+ */
+class SpectrumServer {
+ public:
+  /**
+   * @param argc number of command line arguments
+   * @param argv command line of the server, whose BSG options apply to every request
+   * @param container the options parsed from that command line
+   * @param workDir directory for the output files of the calculations
+   * @param nWorkers number of requests calculated at the same time, 0 to
+   * match the number of available cores
+   * @param keepOutput whether to keep the output files of the calculations
+   */
+  SpectrumServer(int argc, char** argv, BSGOptionContainer& container, std::string workDir, int nWorkers,
+                 bool keepOutput);
+
+  ~SpectrumServer();
+
+  SpectrumServer(const SpectrumServer&) = delete;
+  SpectrumServer& operator=(const SpectrumServer&) = delete;
+
+  /**
+   * Create the socket. A socket file left behind by a server that no longer
+   * runs is replaced.
+   *
+   * @param socketPath path of the socket
+   * @returns false when the socket cannot be created, see GetError()
+   */
+  bool Listen(std::string socketPath);
+
+  /**
+   * Accept clients and answer their requests until stop is set, e.g. by a
+   * signal handler. Queued and running requests are answered as cancelled
+   * and the socket is removed before returning.
+   *
+   * @param stop flag to stop serving, checked several times per second
+   */
+  void Serve(const std::atomic<bool>& stop);
+
+  /**
+   * Reason why the last operation failed, empty otherwise
+   */
+  inline const std::string& GetError() const { return error; };
+
+ private:
+  struct Request;
+
+  /**
+   * A connected client
+   */
+  struct Connection {
+    int fd; /**< socket, closed with the last reference */
+    std::mutex writeMutex; /**< held while a message is written */
+    std::map<std::uint32_t, std::shared_ptr<Request> > requests; /**< unanswered requests, guarded by queueMutex */
+
+    explicit Connection(int _fd) : fd(_fd){};
+    ~Connection();
+  };
+
+  /**
+   * A spectrum request waiting in a queue or being calculated
+   */
+  struct Request {
+    std::uint32_t id;
+    std::shared_ptr<Connection> connection;
+    OptionValues values;
+    std::atomic<bool> cancelled;
+    bool running; /**< taken from its queue by a worker, guarded by queueMutex */
+
+    Request() : id(0), cancelled(false), running(false){};
+  };
+
+  /**
+   * Read the messages of a client until it disconnects
+   */
+  void ReadMessages(std::shared_ptr<Connection> connection);
+
+  /**
+   * Queue a "SPEC" request
+   */
+  void Submit(const std::shared_ptr<Connection>& connection, const ServerMessageHeader& header,
+              const std::string& payload);
+
+  /**
+   * Cancel a queued or running request. Queued requests are answered at once.
+   */
+  void Cancel(const std::shared_ptr<Connection>& connection, std::uint32_t id);
+
+  /**
+   * Loop of a worker
+   *
+   * @param interactiveOnly whether to leave batch requests to the other workers
+   */
+  void Work(bool interactiveOnly);
+
+  /**
+   * Calculate the spectrum of a request and answer it
+   */
+  void Calculate(Request& request);
+
+  /**
+   * Remove a request from its connection and send the answer
+   */
+  void Answer(Request& request, const char* type, const std::string& payload);
+
+  std::string program;
+  std::vector<std::string> sharedArguments; /**< options of the server that apply to every request */
+  std::string workDir;
+  int nWorkers;
+  bool keepOutput;
+  std::atomic<std::uint64_t> nRequests; /**< number of requests calculated, used for output names */
+
+  int listenFd; /**< listening socket, -1 when not listening */
+  std::string socketPath;
+
+  std::mutex queueMutex; /**< guards the queues, the requests of all connections and stopping */
+  std::condition_variable queueCondition;
+  std::deque<std::shared_ptr<Request> > interactive; /**< queued interactive requests */
+  std::deque<std::shared_ptr<Request> > batch; /**< queued batch requests */
+  bool stopping;
+
+  std::mutex connectionsMutex; /**< guards connections and nReaders */
+  std::condition_variable readersCondition;
+  std::set<std::shared_ptr<Connection> > connections;
+  int nReaders; /**< number of threads reading from a client */
+
+  std::string error;
+};
+
+}
+
+#endif  // SERVER
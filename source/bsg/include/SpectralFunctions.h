@@ -46,6 +46,80 @@ double PhaseSpace(double W, double W0, int motherSpinParity,
  */
 double FermiFunction(double W, int Z, double R, int betaType);
 
+/**
+ * W-independent coefficients of the C correction for a single transition.
+ * Both the shape and nuclear-sensitive parts are polynomials in @f$ W @f$, @f$ 1/W @f$ and @f$ W^2 @f$,
+ * so that once these are known the evaluation at any energy is cheap.
+ * @see CalculateCCorrectionCoefficients
+ */
+struct CCorrectionCoefficients {
+  double W0; /**< the total endpoint energy in units of the electron rest mass */
+  int Z; /**< proton number */
+  int A; /**< mass number */
+  double R; /**< nuclear radius in natural units */
+  int betaType; /**< the BetaType of the transition */
+  bool hasShape; /**< false for mixed transitions, for which the shape part vanishes */
+  double S0, S1, Sm1, S2; /**< coefficients of the shape part of @f$ 1, W, 1/W, W^2 @f$ */
+  bool hasNS; /**< true for Gamow-Teller transitions, which have a nuclear-sensitive part */
+  double NS0, NS1, NSm1, NS2; /**< coefficients of the nuclear-sensitive part of @f$ 1, W, 1/W, W^2 @f$ */
+  double phi; /**< relative strength of the induced pseudoscalar contribution */
+  double P0, P1, Pm1; /**< coefficients of the induced pseudoscalar part of @f$ 1, W, 1/W @f$ */
+};
+
+/**
+ * @brief Calculate the W-independent coefficients of the C correction
+ * @param W0 the total endpoint energy in units of the electron rest mass
+ * @param Z proton number
+ * @param A mass number
+ * @param R nuclear radius in natural units
+ * @param betaType the BetaType of the transition
+ * @param decayType the DecayType of the transition
+ * @param gA the axial vector coupling constant
+ * @param gP the induced pseudoscalar coupling constant
+ * @param fc1 the c1 form factor as per Holstein (@f$ g_A M_{GT} @f$)
+ * @param fb the b form factor as per Holstein
+ * @param fd the d form factor as per Holstein
+ * @param ratioM121 the ratio of the @f$^AM_{121}@f$ and @f$ ^AM_{101}@f$ matrix elements in the Behrens-Buehring formalism
+ * @param NSShape string, says which charge distribution to use in the C correction
+ * @param hoFit the fitted A value for the Modified Gaussian distribution
+ * @return the coefficients, to be used once per transition
+ */
+CCorrectionCoefficients CalculateCCorrectionCoefficients(double W0, int Z, int A, double R, int betaType,
+                   int decayType, double gA, double gP, double fc1, double fb, double fd, double ratioM121,
+                   std::string NSShape, double hoFit);
+
+/**
+ * @brief C correction
+ * @param W total energy in units of electron mass
+ * @param coefficients the precalculated coefficients of the transition
+ * @param addCI boolean to decide whether or not to include the isovector correction to the shape part of C
+ * @return the value
+ * @see CalculateCCorrectionCoefficients
+ */
+double CCorrection(double W, const CCorrectionCoefficients& coefficients, bool addCI);
+
+/**
+ * @brief C correction
+ * @param W total energy in units of electron mass
+ * @param coefficients the precalculated coefficients of the transition
+ * @param addCI boolean to decide whether or not to include the isovector correction to the shape part of C
+ * @param spsi NuclearStructure::SingleParticleState object denoting the initial nucleon state
+ * @param spsf NuclearStructure::SingleParticleState object denoting the final nucleon state
+ * @return the value
+ * @see CalculateCCorrectionCoefficients
+ */
+double CCorrection(double W, const CCorrectionCoefficients& coefficients, bool addCI,
+                   nme::NuclearStructure::SingleParticleState& spsi, nme::NuclearStructure::SingleParticleState& spsf);
+
+/**
+ * @brief C correction
+ * @param W total energy in units of electron mass
+ * @param coefficients the precalculated coefficients of the transition
+ * @return the shape and nuclear-sensitive parts in a tuple
+ * @see CalculateCCorrectionCoefficients
+ */
+std::tuple<double, double> CCorrectionComponents(double W, const CCorrectionCoefficients& coefficients);
+
 /**
  * @brief C correction
  * @param W total energy in units of electron mass
@@ -301,6 +375,34 @@ double RecoilCorrection(double W, double W0, int A, int decayType,
  */
 double AtomicScreeningCorrection(double W, int Z, int betaType);
 
+/**
+ * W-independent quantities of the atomic screening correction for a single transition
+ * @see CalculateScreeningContext
+ */
+struct ScreeningContext {
+  double l; /**< twice the weighted inverse screening length of the Salvat potential */
+  double WtShift; /**< shift of the total energy inside the screened potential, @f$ W - \tilde{W} @f$ */
+  double eta; /**< @f$ \pm \alpha Z @f$ with the sign of the BetaType */
+  double gamma; /**< @f$ \sqrt{1-(\alpha Z)^2} @f$ */
+};
+
+/**
+ * @brief Calculate the W-independent quantities of the atomic screening correction
+ * @param Z proton number
+ * @param betaType the BetaType of the transition
+ * @return the screening context, to be used once per transition
+ */
+ScreeningContext CalculateScreeningContext(int Z, int betaType);
+
+/**
+ * Correction due to atomic screening calculated using the Salvat potential
+ *
+ * @param W electron total energy in units of its rest mass
+ * @param context the precalculated screening context of the transition
+ * @see CalculateScreeningContext
+ */
+double AtomicScreeningCorrection(double W, const ScreeningContext& context);
+
 /**
  * The atomic exchange correction where an electron decays into a bound state of the daughter atom
  * and its corresponding interference with the direct process
@@ -335,6 +437,101 @@ double AtomicMismatchCorrection(double W, double W0, int Z, int A,
  *\sum_{k=1}^{k=\infty}\frac{x^k}{k^2} \equiv -\mathrm{Li}_2(x) \f]
  */
 double Spence(double x);
+
+/**
+ * @defgroup batch Batch evaluation
+ * Versions of the corrections that evaluate a contiguous array of energies at once.
+ * All W-independent quantities are calculated once per call, and the
+ * remaining loops are simple enough for the compiler to vectorise.
+ * Each writes @p size values into @p result, which may not alias @p W.
+ * @{
+ */
+
+/**
+ * @brief Phase space for an array of energies
+ * @see PhaseSpace(double, double, int, int)
+ */
+void PhaseSpace(const double W[], double result[], int size, double W0,
+                int motherSpinParity, int daughterSpinParity);
+
+/**
+ * @brief Fermi function for an array of energies
+ * @see FermiFunction(double, int, double, int)
+ */
+void FermiFunction(const double W[], double result[], int size, int Z,
+                   double R, int betaType);
+
+/**
+ * @brief C correction for an array of energies. The occupation numbers
+ * entering the isovector correction are determined once per call.
+ * @see CCorrection(double, const CCorrectionCoefficients&, bool)
+ */
+void CCorrection(const double W[], double result[], int size,
+                 const CCorrectionCoefficients& coefficients, bool addCI);
+
+/**
+ * @brief C correction for an array of energies using single-particle wave functions.
+ * The radial matrix elements entering the isovector correction are calculated once per call.
+ * @see CCorrection(double, const CCorrectionCoefficients&, bool, nme::NuclearStructure::SingleParticleState&, nme::NuclearStructure::SingleParticleState&)
+ */
+void CCorrection(const double W[], double result[], int size,
+                 const CCorrectionCoefficients& coefficients, bool addCI,
+                 nme::NuclearStructure::SingleParticleState& spsi,
+                 nme::NuclearStructure::SingleParticleState& spsf);
+
+/**
+ * @brief Finite size correction @f$L_0 @f$ for an array of energies
+ * @see L0Correction(double, int, double, int, double[], double[])
+ */
+void L0Correction(const double W[], double result[], int size, int Z,
+                  double r, int betaType, double aPos[], double aNeg[]);
+
+/**
+ * @brief U correction for an array of energies
+ * @see UCorrection(double, int, double, int, std::string, std::vector<double>&, std::vector<double>&)
+ */
+void UCorrection(const double W[], double result[], int size, int Z, double R,
+                 int betaType, std::string ESShape, std::vector<double>& v,
+                 std::vector<double>& vp);
+
+/**
+ * @brief Coulomb recoil correction for an array of energies
+ * @see QCorrection(double, double, int, int, int, int, double)
+ */
+void QCorrection(const double W[], double result[], int size, double W0,
+                 int Z, int A, int betaType, int decayType, double mixingRatio);
+
+/**
+ * @brief Radiative correction for an array of energies
+ * @see RadiativeCorrection(double, double, int, double, int, double, double)
+ */
+void RadiativeCorrection(const double W[], double result[], int size,
+                         double W0, int Z, double R, int betaType, double gA,
+                         double gM);
+
+/**
+ * @brief Neutrino radiative correction for an array of energies
+ * @see NeutrinoRadiativeCorrection(double)
+ */
+void NeutrinoRadiativeCorrection(const double Wv[], double result[], int size);
+
+/**
+ * @brief Kinematic recoil correction for an array of energies
+ * @see RecoilCorrection(double, double, int, int, double)
+ */
+void RecoilCorrection(const double W[], double result[], int size, double W0,
+                      int A, int decayType, double mixingRatio);
+
+/**
+ * @brief Atomic exchange correction for an array of energies.
+ * The parametrisation has no W-independent part besides exPars, which the
+ * caller looks up once per transition, so this is a scalar fallback calling
+ * AtomicExchangeCorrection(double, double[]) for every energy.
+ * @see AtomicExchangeCorrection(double, double[])
+ */
+void AtomicExchangeCorrection(const double W[], double result[], int size,
+                              double exPars[9]);
+/** @} */
 }
 }
 
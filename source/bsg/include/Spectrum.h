@@ -0,0 +1,260 @@
+#ifndef SPECTRUM
+#define SPECTRUM
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace bsg {
+
+/**
+ * Generator for the total electron energies on which a spectrum is evaluated,
+ * so that the grid can be produced one block at a time
+ */
+class EnergyGrid {
+ public:
+  /**
+   * Regular grid, from beginW up to and including endW in steps of stepW
+   */
+  EnergyGrid(double beginW, double endW, double stepW)
+      : beginW(beginW), endW(endW), stepW(stepW), currentW(beginW), nodes(0), k(0),
+        isList(false) {};
+
+  /**
+   * Equidistant grid of nodes + 1 points from beginW to endW, both included
+   */
+  EnergyGrid(double beginW, double endW, int nodes)
+      : beginW(beginW), endW(endW), stepW((endW - beginW) / nodes), currentW(beginW),
+        nodes(nodes), k(0), isList(false) {};
+
+  /**
+   * Grid of explicitly given energies, in the order in which they are given
+   */
+  EnergyGrid(std::vector<double> energies)
+      : beginW(0.), endW(0.), stepW(0.), currentW(0.), nodes(0), k(0), isList(true),
+        list(energies) {};
+
+  /**
+   * Append at most n of the next energies to block
+   *
+   * @param block vector to which the energies are appended
+   * @param n maximal number of energies
+   * @returns the number of energies that were appended, 0 at the end of the grid
+   */
+  inline std::size_t Next(std::vector<double>& block, std::size_t n) {
+    std::size_t added = 0;
+    if (isList) {
+      while (added < n && (std::size_t)k < list.size()) {
+        block.push_back(list[k]);
+        k++;
+        added++;
+      }
+    } else if (nodes > 0) {
+      while (added < n && k <= nodes) {
+        block.push_back(beginW + k * stepW);
+        k++;
+        added++;
+      }
+    } else {
+      while (added < n && currentW <= endW) {
+        block.push_back(currentW);
+        currentW += stepW;
+        added++;
+      }
+    }
+    return added;
+  };
+
+  /**
+   * Number of energies that Next will still produce, without producing them
+   */
+  inline std::size_t Count() const {
+    if (isList) {
+      return list.size() - k;
+    }
+    if (nodes > 0) {
+      return k <= nodes ? nodes - k + 1 : 0;
+    }
+    // repeat the accumulation of Next, so that rounding gives the same count
+    std::size_t n = 0;
+    for (double w = currentW; w <= endW; w += stepW) {
+      n++;
+    }
+    return n;
+  };
+
+  /**
+   * First energy of the whole grid, 0 for an empty list
+   */
+  inline double GetFirst() const {
+    if (isList) {
+      return list.empty() ? 0. : list.front();
+    }
+    return beginW;
+  };
+
+  /**
+   * Last energy of the whole grid, which for a regular grid can lie below endW, 0 for an empty list
+   */
+  inline double GetLast() const {
+    if (isList) {
+      return list.empty() ? 0. : list.back();
+    }
+    if (nodes > 0) {
+      return beginW + nodes * stepW;
+    }
+    // repeat the accumulation of Next, so that rounding gives the same energy
+    double last = beginW;
+    for (double w = beginW; w <= endW; w += stepW) {
+      last = w;
+    }
+    return last;
+  };
+
+  /**
+   * Distance between consecutive energies, 0 for a list
+   */
+  inline double GetStep() const { return stepW; };
+
+  inline bool IsList() const { return isList; };
+
+ private:
+  double beginW, endW, stepW;
+  double currentW; /**< next energy of a regular grid */
+  int nodes; /**< number of intervals of an equidistant grid, 0 for a regular grid */
+  int k; /**< index of the next node of an equidistant grid or of the list */
+  bool isList; /**< whether the energies are given explicitly */
+  std::vector<double> list; /**< explicitly given energies */
+};
+
+/**
+ * Calculated beta spectrum stored column-wise.
+ * Each quantity is kept in its own contiguous array, indexed by grid point,
+ * so that a spectrum of millions of points needs only a handful of allocations.
+ */
+class Spectrum {
+ public:
+  /**
+   * Change the number of grid points, resizing all columns
+   *
+   * @param n the new number of grid points
+   */
+  inline void Resize(std::size_t n) {
+    W.resize(n);
+    electron.resize(n);
+    neutrino.resize(n);
+    for (auto& c : columns) c.second.resize(n);
+  };
+
+  /**
+   * Remove all grid points and additional columns
+   */
+  inline void Clear() {
+    W.clear();
+    electron.clear();
+    neutrino.clear();
+    columns.clear();
+  };
+
+  inline std::size_t Size() const { return W.size(); };
+
+  inline std::vector<double>& GetW() { return W; };
+  inline const std::vector<double>& GetW() const { return W; };
+  inline std::vector<double>& GetElectron() { return electron; };
+  inline const std::vector<double>& GetElectron() const { return electron; };
+  inline std::vector<double>& GetNeutrino() { return neutrino; };
+  inline const std::vector<double>& GetNeutrino() const { return neutrino; };
+
+  /**
+   * Add an additional column, e.g. the value of a single correction, or
+   * return it when it already exists
+   *
+   * @param name name of the column
+   * @returns the column, with one entry per grid point
+   */
+  inline std::vector<double>& AddColumn(std::string name) {
+    std::vector<double>& c = columns[name];
+    c.resize(W.size());
+    return c;
+  };
+
+  inline bool HasColumn(std::string name) const { return columns.count(name) > 0; };
+
+  inline const std::vector<double>& GetColumn(std::string name) const { return columns.at(name); };
+
+  inline const std::map<std::string, std::vector<double> >& GetColumns() const { return columns; };
+
+  /**
+   * Name of the column holding the electron factor of a correction
+   */
+  inline static std::string ElectronColumn(std::string correction) { return "electron:" + correction; };
+
+  /**
+   * Name of the column holding the neutrino factor of a correction
+   */
+  inline static std::string NeutrinoColumn(std::string correction) { return "neutrino:" + correction; };
+
+  /**
+   * Multiply the factors of a set of corrections, which were stored in the
+   * columns named by ElectronColumn and NeutrinoColumn, without evaluating
+   * any correction again. Negative products are set to zero, as for the
+   * calculated decay rates.
+   *
+   * @param corrections names of the corrections to include, in the order in which they are multiplied
+   * @param electronResult vector to be filled with the electron decay rates
+   * @param neutrinoResult vector to be filled with the neutrino decay rates
+   * @throws std::invalid_argument when the factors of a correction were not stored,
+   * i.e. the spectrum was calculated without the breakdown option
+   */
+  inline void Recompose(const std::vector<std::string>& corrections, std::vector<double>& electronResult,
+                        std::vector<double>& neutrinoResult) const {
+    for (const auto& name : corrections) {
+      if (!HasColumn(ElectronColumn(name)) || !HasColumn(NeutrinoColumn(name))) {
+        throw std::invalid_argument("Recomposing the spectrum requires --breakdown, the factors of the " + name +
+                                    " correction were not stored");
+      }
+    }
+    std::size_t n = W.size();
+    electronResult.assign(n, 1.);
+    neutrinoResult.assign(n, 1.);
+    for (const auto& name : corrections) {
+      const std::vector<double>& e = columns.at(ElectronColumn(name));
+      const std::vector<double>& v = columns.at(NeutrinoColumn(name));
+      for (std::size_t i = 0; i < n; i++) {
+        electronResult[i] *= e[i];
+        neutrinoResult[i] *= v[i];
+      }
+    }
+    for (std::size_t i = 0; i < n; i++) {
+      electronResult[i] = std::max(0., electronResult[i]);
+      neutrinoResult[i] = std::max(0., neutrinoResult[i]);
+    }
+  };
+
+  /**
+   * Copy the spectrum into the row-wise layout used previously, i.e. one
+   * {W, electron rate, neutrino rate} entry per grid point
+   *
+   * @returns vector of rows
+   */
+  inline std::vector<std::vector<double> > ToRows() const {
+    std::vector<std::vector<double> > rows;
+    rows.reserve(W.size());
+    for (std::size_t i = 0; i < W.size(); i++) {
+      rows.push_back({W[i], electron[i], neutrino[i]});
+    }
+    return rows;
+  };
+
+ private:
+  std::vector<double> W; /**< total electron energies in units of its rest mass */
+  std::vector<double> electron; /**< electron decay rate */
+  std::vector<double> neutrino; /**< neutrino decay rate */
+  std::map<std::string, std::vector<double> > columns; /**< optional additional columns by name */
+};
+
+}
+
+#endif  // SPECTRUM
@@ -0,0 +1,139 @@
+#ifndef SPECTRUMFILE
+#define SPECTRUMFILE
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace bsg {
+
+/**
+ * Magic string at the start of a binary spectrum file
+ */
+const char SPECTRUM_FILE_MAGIC[8] = {'B', 'S', 'G', 'S', 'P', 'E', 'C', '\0'};
+/**
+ * Magic string at the start of a framed binary spectrum stream, see StreamSpectrumWriter
+ */
+const char SPECTRUM_STREAM_MAGIC[8] = {'B', 'S', 'G', 'S', 'T', 'R', 'M', '\0'};
+/**
+ * Version of the binary spectrum file layout, increased for incompatible changes
+ */
+const std::uint32_t SPECTRUM_FILE_VERSION = 1;
+/**
+ * Value of the byteOrder field as written by the machine that created the file
+ */
+const std::uint32_t SPECTRUM_FILE_BYTE_ORDER = 0x01020304;
+/**
+ * Byte offset of the first column, leaving room for future header fields
+ */
+const std::uint64_t SPECTRUM_FILE_DATA_OFFSET = 256;
+
+/**
+ * Fixed header of a binary spectrum file.
+ * The header is followed, starting at dataOffset, by nColumns contiguous
+ * arrays of nPoints native doubles each: the total electron energy W, the
+ * electron and the neutrino decay rate.
+ */
+struct SpectrumFileHeader {
+  char magic[8]; /**< SPECTRUM_FILE_MAGIC */
+  std::uint32_t version; /**< SPECTRUM_FILE_VERSION */
+  std::uint32_t byteOrder; /**< SPECTRUM_FILE_BYTE_ORDER in the byte order of the writer */
+  std::uint32_t nColumns; /**< number of columns */
+  std::int32_t betaType; /**< 1 for beta-, -1 for beta+ */
+  std::uint64_t nPoints; /**< number of grid points */
+  std::uint64_t dataOffset; /**< byte offset of the first column */
+  std::uint64_t optionsHash; /**< hash of the options that determine the spectrum */
+  double Z; /**< proton number of the daughter nucleus */
+  double A; /**< mass number */
+  double R; /**< nuclear radius in natural units */
+  double W0; /**< endpoint energy in units of the electron rest mass */
+  double QValue; /**< Q value in keV */
+  double mixingRatio; /**< mixing ratio of Fermi vs Gamow-Teller decay */
+  double motherExcitationEn; /**< excitation energy of the mother state in keV */
+  double daughterExcitationEn; /**< excitation energy of the daughter state in keV */
+  std::int32_t motherSpinParity; /**< double of the spin parity of the mother state */
+  std::int32_t daughterSpinParity; /**< double of the spin parity of the daughter state */
+  char columnNames[3][16]; /**< names of the columns */
+};
+
+static_assert(sizeof(SpectrumFileHeader) <= SPECTRUM_FILE_DATA_OFFSET,
+              "Spectrum file header does not fit before the data");
+
+/**
+ * Read-only view of a binary spectrum file.
+ * The file is mapped into memory, so that opening it costs nothing beyond
+ * checking the header and the columns are only read from disk when accessed.
+ */
+class SpectrumFile {
+ public:
+  SpectrumFile();
+
+  /**
+   * Open the file, check IsOpen() and GetError() for the result
+   *
+   * @param fileName name of the binary spectrum file
+   */
+  SpectrumFile(std::string fileName);
+
+  ~SpectrumFile();
+
+  SpectrumFile(const SpectrumFile&) = delete;
+  SpectrumFile& operator=(const SpectrumFile&) = delete;
+
+  /**
+   * Map a binary spectrum file, closing the previous one
+   *
+   * @param fileName name of the binary spectrum file
+   * @returns true when the file could be mapped and has a valid header
+   */
+  bool Open(std::string fileName);
+
+  /**
+   * Unmap the file. Pointers to the columns become invalid.
+   */
+  void Close();
+
+  inline bool IsOpen() const { return data != nullptr; };
+
+  /**
+   * Reason why the last Open failed, empty otherwise
+   */
+  inline const std::string& GetError() const { return error; };
+
+  inline const SpectrumFileHeader& GetHeader() const { return *header; };
+
+  inline std::size_t Size() const { return header->nPoints; };
+
+  /**
+   * Get a column directly from the mapped file
+   *
+   * @param column index of the column, 0 for W, 1 for electron, 2 for neutrino
+   * @returns pointer to the first of Size() values
+   */
+  inline const double* GetColumn(int column) const {
+    return reinterpret_cast<const double*>(data + header->dataOffset) + column * header->nPoints;
+  };
+
+  inline const double* GetW() const { return GetColumn(0); };
+  inline const double* GetElectron() const { return GetColumn(1); };
+  inline const double* GetNeutrino() const { return GetColumn(2); };
+
+  /**
+   * Find the grid points inside an energy window without reading the others
+   *
+   * @param beginW lower edge of the window
+   * @param endW upper edge of the window
+   * @returns first index and one past the last index with beginW <= W <= endW
+   */
+  std::pair<std::size_t, std::size_t> FindRange(double beginW, double endW) const;
+
+ private:
+  const char* data; /**< start of the mapped file, nullptr when closed */
+  std::size_t length; /**< length of the mapping in bytes */
+  const SpectrumFileHeader* header; /**< header at the start of the mapping */
+  std::string error;
+};
+
+}
+
+#endif  // SPECTRUMFILE
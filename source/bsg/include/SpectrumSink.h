@@ -0,0 +1,146 @@
+#ifndef SPECTRUMSINK
+#define SPECTRUMSINK
+
+#include <string>
+
+#include "Spectrum.h"
+#include "Utilities.h"
+
+namespace bsg {
+
+/**
+ * Receiver of the points of a spectrum in order of increasing energy
+ */
+class SpectrumSink {
+ public:
+  virtual ~SpectrumSink(){};
+
+  /**
+   * Receive the next point of the spectrum
+   *
+   * @param W total electron energy in units of its rest mass
+   * @param electron electron decay rate
+   * @param neutrino neutrino decay rate
+   */
+  virtual void Push(double W, double electron, double neutrino) = 0;
+
+  /**
+   * Finish the spectrum, e.g. by writing what is left to disk
+   *
+   * @returns false when not everything could be written, see GetError()
+   */
+  virtual bool Close() { return true; };
+
+  /**
+   * Reason why the spectrum could not be written, empty otherwise
+   */
+  virtual std::string GetError() const { return std::string(); };
+};
+
+/**
+ * Sink storing all points in a Spectrum
+ */
+class SpectrumStore : public SpectrumSink {
+ public:
+  SpectrumStore(Spectrum& _spectrum) : spectrum(_spectrum){};
+
+  inline void Push(double W, double electron, double neutrino) {
+    spectrum.GetW().push_back(W);
+    spectrum.GetElectron().push_back(electron);
+    spectrum.GetNeutrino().push_back(neutrino);
+  };
+
+ private:
+  Spectrum& spectrum;
+};
+
+/**
+ * Sink accumulating the moments @f$ \int W^k N(W) dW @f$ of the electron spectrum
+ * for k = 0, 1, 2 without storing it. The integrals are calculated with the
+ * same composite Simpson rule as utilities::Simpson, i.e. on consecutive pairs of
+ * intervals, but the contributions are added using compensated summation.
+ */
+class SpectrumMoments : public SpectrumSink {
+ public:
+  static const int N_MOMENTS = 3;
+
+  /**
+   * Everything needed to continue the accumulation later, e.g. in a restarted process
+   */
+  struct State {
+    int count;
+    double x[3];
+    double y[3];
+    utilities::CompensatedSum moments[N_MOMENTS];
+  };
+
+  SpectrumMoments() { Reset(); };
+
+  inline void Reset() {
+    count = 0;
+    for (int k = 0; k < N_MOMENTS; k++) moments[k].Reset();
+  };
+
+  inline void Push(double W, double electron, double neutrino) {
+    int i = count % 3;
+    x[i] = W;
+    y[i] = electron;
+    count++;
+    if (count >= 3 && count % 2 == 1) {
+      AddPanel();
+      // the last point of this panel is the first of the next one
+      x[0] = x[2];
+      y[0] = y[2];
+      count = 1;
+    }
+  };
+
+  /**
+   * @param k order of the moment, at most N_MOMENTS - 1
+   * @returns the integral of @f$ W^k N(W) @f$ over the points received so far
+   */
+  inline double GetMoment(int k) const { return moments[k].GetValue(); };
+
+  inline State GetState() const {
+    State state;
+    state.count = count;
+    std::copy(x, x + 3, state.x);
+    std::copy(y, y + 3, state.y);
+    std::copy(moments, moments + N_MOMENTS, state.moments);
+    return state;
+  };
+
+  inline void SetState(const State& state) {
+    count = state.count;
+    std::copy(state.x, state.x + 3, x);
+    std::copy(state.y, state.y + 3, y);
+    std::copy(state.moments, state.moments + N_MOMENTS, moments);
+  };
+
+ private:
+  inline void AddPanel() {
+    double h = (x[2] - x[0]) / 2.;
+    double xk[] = {1., 1., 1.};
+    for (int k = 0; k < N_MOMENTS; k++) {
+      double yN[] = {xk[0] * y[0], xk[1] * y[1], xk[2] * y[2]};
+      utilities::Lagrange l(x, yN);
+      double panel = 1. / 3. * h * (yN[0] + 4. * l.GetValue(x[0] + h) + yN[2]);
+      if (panel != panel) {
+        // follow utilities::Simpson, which discards everything up to a NaN
+        moments[k].Reset();
+      } else {
+        moments[k].Add(panel);
+      }
+      for (int j = 0; j < 3; j++) xk[j] *= x[j];
+    }
+  };
+
+  int count; /**< number of points in the current panel */
+  double x[3]; /**< energies of the current panel */
+  double y[3]; /**< electron decay rates of the current panel */
+  utilities::CompensatedSum moments[N_MOMENTS];
+};
+
+}
+
+#endif  // SPECTRUMSINK
@@ -0,0 +1,248 @@
+#ifndef SPECTRUMWRITER
+#define SPECTRUMWRITER
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spdlog/fmt/fmt.h"
+
+#include "SpectrumFile.h"
+#include "SpectrumSink.h"
+
+namespace bsg {
+
+/**
+ * File writer collecting data into large blocks, which are written to disk
+ * by a background thread so that the calculation does not wait for I/O
+ */
+class BufferedFileWriter {
+ public:
+  /**
+   * Open the file and start the background thread
+   *
+   * @param fileName name of the file
+   * @param append if true, append to an existing file instead of truncating it
+   * @param blockSize number of bytes collected before a block is handed to the background thread
+   */
+  BufferedFileWriter(std::string fileName, bool append, std::size_t blockSize = 1 << 20);
+
+  /**
+   * Write to an already open stream, e.g. stdout, which is flushed but not closed by Close()
+   *
+   * @param stream the stream
+   * @param blockSize number of bytes collected before a block is handed to the background thread
+   */
+  BufferedFileWriter(std::FILE* stream, std::size_t blockSize = 1 << 20);
+
+  /**
+   * Destructor, writes all remaining data and closes the file
+   */
+  ~BufferedFileWriter();
+
+  BufferedFileWriter(const BufferedFileWriter&) = delete;
+  BufferedFileWriter& operator=(const BufferedFileWriter&) = delete;
+
+  /**
+   * Append data to the file
+   *
+   * @param data pointer to the data
+   * @param size number of bytes
+   */
+  void Write(const char* data, std::size_t size);
+
+  /**
+   * Write a block at a fixed position in the file, which must not have been
+   * opened for appending. The block is handed to the background thread directly.
+   *
+   * @param offset byte offset in the file
+   * @param block data to write, which is moved from
+   */
+  void WriteAt(std::uint64_t offset, std::string&& block);
+
+  /**
+   * Hand the data collected so far to the background thread, without waiting for it to be written
+   */
+  void Flush();
+
+  /**
+   * Write all remaining data, wait for the background thread and close the file
+   *
+   * @returns false when the file could not be opened or not everything was written, see GetError()
+   */
+  bool Close();
+
+  inline bool IsOpen() const { return file != nullptr; };
+
+  /**
+   * First error that occurred while opening or writing the file, empty
+   * otherwise. Complete only after Close().
+   */
+  inline const std::string& GetError() const { return error; };
+
+ private:
+  /**
+   * Data waiting to be written, with its position in the file
+   */
+  struct Block {
+    std::int64_t offset; /**< byte offset, or -1 to write at the current position */
+    std::string data;
+  };
+
+  /**
+   * Hand a block to the background thread
+   *
+   * @param offset byte offset, or -1 to write at the current position
+   * @param data data to write, which is moved from
+   */
+  void Submit(std::int64_t offset, std::string& data);
+
+  /**
+   * Loop of the background thread
+   */
+  void Run();
+
+  std::FILE* file; /**< the output file, nullptr if it could not be opened */
+  std::string fileName; /**< name used in error messages */
+  bool owned; /**< whether file was opened by this writer and has to be closed */
+  std::size_t blockSize; /**< size above which a block is submitted */
+  std::string current; /**< block being filled by the calculation thread */
+  std::deque<Block> pending; /**< blocks waiting to be written */
+  bool closing; /**< set when no more blocks will be submitted */
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::thread worker;
+  std::string error; /**< first error, set by the background thread until it is joined */
+};
+
+/**
+ * Sink writing the spectrum as text, with the same formatting as the raw and results files
+ */
+class TextSpectrumWriter : public SpectrumSink {
+ public:
+  /**
+   * @param fileName name of the file
+   * @param neutrino whether to write the neutrino column
+   * @param append if true, append to an existing file instead of truncating it
+   */
+  TextSpectrumWriter(std::string fileName, bool neutrino, bool append);
+
+  void Push(double W, double electron, double neutrino);
+
+  inline bool Close() { return output.Close(); };
+
+  inline bool IsOpen() const { return output.IsOpen(); };
+
+  inline std::string GetError() const { return output.GetError(); };
+
+ private:
+  BufferedFileWriter output;
+  bool writeNeutrino; /**< whether to write the neutrino column */
+  fmt::memory_buffer line; /**< formatting buffer, reused for every point */
+};
+
+/**
+ * Sink writing a binary spectrum file as described by SpectrumFileHeader,
+ * which can be read back with SpectrumFile.
+ * Because the columns are stored one after the other, the number of points
+ * has to be known in advance. Each column is collected into blocks which are
+ * written at their final position in the file.
+ */
+class BinarySpectrumWriter : public SpectrumSink {
+ public:
+  /**
+   * Create the file and write its header
+   *
+   * @param fileName name of the file, which is truncated
+   * @param header header to write, with all fields but the magic string, version,
+   * byte order, column layout and names filled in
+   */
+  BinarySpectrumWriter(std::string fileName, const SpectrumFileHeader& header);
+
+  ~BinarySpectrumWriter();
+
+  void Push(double W, double electron, double neutrino);
+
+  /**
+   * Write the remaining blocks and close the file
+   */
+  bool Close();
+
+  inline bool IsOpen() const { return output.IsOpen(); };
+
+  inline std::string GetError() const { return output.GetError(); };
+
+ private:
+  /**
+   * Write the collected blocks of all columns
+   */
+  void WriteColumns();
+
+  BufferedFileWriter output;
+  SpectrumFileHeader header;
+  std::string columns[3]; /**< blocks of W, electron and neutrino values waiting to be written */
+  std::uint64_t blockStart; /**< index of the first point in the current blocks */
+  std::uint64_t count; /**< number of points received */
+};
+
+/**
+ * Sink writing the spectrum to a stream such as stdout while it is being
+ * calculated, divided into frames so that a consumer can process each frame
+ * as soon as it arrives.
+ *
+ * In binary form, the stream starts with a SpectrumFileHeader whose magic
+ * string is SPECTRUM_STREAM_MAGIC, padded to dataOffset bytes. Every frame
+ * consists of the 4 characters "CHNK", a 32-bit number of points n and the
+ * columns W, electron and neutrino of n native doubles each. The stream ends
+ * with "DONE" followed by the 32-bit total number of points modulo 2^32.
+ *
+ * In text form, header lines start with '#', each frame starts with a line
+ * "# chunk <n>" followed by n lines as in the raw file, and the stream ends
+ * with "# end <total number of points>".
+ */
+class StreamSpectrumWriter : public SpectrumSink {
+ public:
+  /**
+   * Write the stream header
+   *
+   * @param stream the stream, which is not closed
+   * @param binary whether to use the binary rather than the text form
+   * @param header transition data for the stream header, filled in as for BinarySpectrumWriter
+   * @param chunkSize number of points per frame
+   */
+  StreamSpectrumWriter(std::FILE* stream, bool binary, const SpectrumFileHeader& header,
+                       std::size_t chunkSize = 4096);
+
+  ~StreamSpectrumWriter();
+
+  void Push(double W, double electron, double neutrino);
+
+  /**
+   * Write the last frame and the end of the stream
+   */
+  bool Close();
+
+  inline std::string GetError() const { return output.GetError(); };
+
+ private:
+  /**
+   * Write the points received since the previous frame as a frame
+   */
+  void WriteFrame();
+
+  BufferedFileWriter output;
+  bool binary; /**< whether to use the binary form */
+  std::size_t chunkSize; /**< number of points per frame */
+  std::vector<double> columns[3]; /**< W, electron and neutrino of the current frame */
+  std::uint64_t count; /**< number of points received */
+  bool closed;
+};
+
+}
+
+#endif  // SPECTRUMWRITER
@@ -7,6 +7,9 @@
 #include <stdlib.h>
 #include <vector>
 #include <complex>
+#include <functional>
+#include <cmath>
+#include <mutex>
 
 #include "Constants.h"
 
@@ -78,6 +81,67 @@ inline int DoubleFactorial(int n) {
   }
 }
 
+/**
+ * Calculate the logarithm of the magnitude of the complex Gamma function,
+ * @f$ \ln|\Gamma(x+iy)| @f$, without recourse to GSL.
+ *
+ * The argument is shifted upwards by a fixed 7 steps of the recurrence
+ * relation, after which Stirling's series is used up to @f$ z^{-13} @f$.
+ * The shift multiplies factors @f$ |z+k|^2/|z+7|^2 \le 1 @f$, which
+ * cannot overflow, so the function has no data-dependent branches or trip
+ * counts and uses four transcendental function calls. Loops calling it can
+ * therefore be vectorised by the compiler when a vector math library is
+ * available, e.g. glibc's with -ffast-math.
+ *
+ * The series is only accurate when the shifted argument satisfies
+ * @f$ |z+7| \ge 7 @f$, so the function requires @f$ x > 0 @f$. This holds
+ * in the Fermi function, where @f$ x = \gamma @f$, but not for all
+ * arguments of the screening correction, whose real part can be as low as
+ * about -3.4; those are passed to GSL instead. For @f$ x > 0 @f$ the
+ * difference with gsl_sf_lngamma_complex_e is below
+ * @f$ 10^{-12} \max(1, |\ln|\Gamma||) @f$. The bound is relative because
+ * the result grows like @f$ \pi|y|/2 @f$, and @f$ |y| @f$ reaches several
+ * thousand in the screening correction. This is verified by the lngamma_check
+ * test over the arguments of both corrections.
+ *
+ * @param x real part of the argument, positive
+ * @param y imaginary part of the argument
+ */
+inline double LnGammaComplexMagnitude(double x, double y) {
+  const int nShift = 7;
+  double y2 = y * y;
+  double xs = x + nShift;
+  double r2 = xs * xs + y2;
+  // ln|z (z+1) ... (z+6)|^2 = nShift ln|z+7|^2 + sum_k ln(|z+k|^2/|z+7|^2)
+  double product = 1.;
+  for (int k = 0; k < nShift; k++) {
+    double xk = x + k;
+    product *= (xk * xk + y2) / r2;
+  }
+  double shift = nShift * std::log(r2) + std::log(product);
+
+  // w = 1/z and w2 = 1/z^2 of the shifted argument
+  double wRe = xs / r2;
+  double wIm = -y / r2;
+  double w2Re = wRe * wRe - wIm * wIm;
+  double w2Im = 2. * wRe * wIm;
+
+  // Stirling series sum_k B_2k/(2k(2k-1)) w^(2k-1) evaluated with Horner's scheme in w^2
+  static const double c[] = {1. / 12., -1. / 360., 1. / 1260., -1. / 1680.,
+                             1. / 1188., -691. / 360360., 1. / 156.};
+  double sRe = c[6];
+  double sIm = 0.;
+  for (int k = 5; k >= 0; k--) {
+    double tRe = sRe * w2Re - sIm * w2Im + c[k];
+    sIm = sRe * w2Im + sIm * w2Re;
+    sRe = tRe;
+  }
+  double series = sRe * wRe - sIm * wIm;
+
+  return (xs - 0.5) * 0.5 * std::log(r2) - y * std::atan2(y, xs) - xs +
+         0.5 * std::log(2. * M_PI) + series - 0.5 * shift;
+}
+
 /**
  * Calculate the Clebsch-Gordan coefficient
  *
@@ -167,6 +231,101 @@ class Lagrange {
   double yC[3];
 };
 
+/**
+ * Running sum with Neumaier's compensation for the rounding error,
+ * so that the result does not depend on the number of terms
+ */
+class CompensatedSum {
+ public:
+  inline void Add(double x) {
+    double t = sum + x;
+    if (std::abs(sum) >= std::abs(x)) {
+      compensation += (sum - t) + x;
+    } else {
+      compensation += (x - t) + sum;
+    }
+    sum = t;
+  };
+  inline double GetValue() const { return sum + compensation; };
+  inline void Reset() { sum = compensation = 0.; };
+
+ private:
+  double sum = 0.;
+  double compensation = 0.;
+};
+
+/**
+ * Monotone piecewise cubic Hermite interpolation between a set of (x,y) points,
+ * with the derivatives chosen as per Fritsch and Carlson, SIAM J. Numer. Anal. 17 (1980) 238
+ * so that the interpolant does not overshoot the data.
+ */
+class MonotoneSpline {
+ public:
+  MonotoneSpline(){};
+  /**
+   * @param x strictly increasing x values, at least 2
+   * @param y y values
+   */
+  MonotoneSpline(const std::vector<double>& x, const std::vector<double>& y);
+  double GetValue(double) const;
+  /**
+   * Check whether x lies within the interpolation range
+   */
+  inline bool Contains(double x) const { return !xC.empty() && x >= xC.front() && x <= xC.back(); };
+  inline std::size_t Size() const { return xC.size(); };
+
+ private:
+  std::vector<double> xC;
+  std::vector<double> yC;
+  std::vector<double> dC; /**< derivatives at the nodes */
+};
+
+/**
+ * Construct a MonotoneSpline for a smooth function on [a, b] using as few
+ * evaluations as possible. Starting from equidistant nodes, each interval
+ * is bisected until the interpolated value at its midpoint agrees with the
+ * exact one within the relative tolerance. As bisecting an interval changes
+ * the derivatives at its ends, all midpoints are checked again against the
+ * refined spline, reusing their exact values.
+ *
+ * @param f function to interpolate
+ * @param a lower limit of the interpolation range
+ * @param b upper limit of the interpolation range
+ * @param tolerance maximal relative difference at the midpoints
+ * @param maxNodes maximal number of nodes, after which refinement stops
+ * @param errorEstimate set to the largest relative difference between the
+ * returned spline and f at the midpoints of its intervals. This is an estimate
+ * rather than a bound of the error elsewhere.
+ * @returns the spline through the nodes; the midpoints of its intervals are
+ * only used as checks and are not nodes
+ */
+MonotoneSpline AdaptiveMonotoneSpline(std::function<double(double)> f, double a,
+                                      double b, double tolerance, int maxNodes,
+                                      double& errorEstimate);
+
+/**
+ * Calculate the nodes and weights of n-point Gauss-Legendre quadrature on [-1, 1]
+ *
+ * @param n number of nodes
+ * @param nodes vector to be filled with the nodes in ascending order
+ * @param weights vector to be filled with the corresponding weights
+ */
+void GaussLegendre(int n, std::vector<double>& nodes, std::vector<double>& weights);
+
+/**
+ * Read all numbers from a text file, separated by whitespace. Lines starting with # are skipped.
+ *
+ * @param fileName name of the file
+ * @param values vector to which the numbers are appended
+ * @returns false if the file cannot be read or contains something other than numbers
+ */
+bool ReadValues(std::string fileName, std::vector<double>& values);
+
+/**
+ * Mutex to hold while calling into ROOT, whose global state is not thread safe
+ */
+std::mutex& GetRootMutex();
+
 /**
  * Perform Simpson integration
  *
@@ -180,22 +339,43 @@ inline double Simpson(double x[], double y[], int size) {
     double xN[] = {x[i], x[i + 1], x[i + 2]};
     double yN[] = {y[i], y[i + 1], y[i + 2]};
     double h = (xN[2] - xN[0]) / 2.;
-    Lagrange* l = new Lagrange(xN, yN);
-    result += 1. / 3. * h * (y[i] + 4. * l->GetValue(xN[0] + h) + y[i + 2]);
+    Lagrange l(xN, yN);
+    result += 1. / 3. * h * (y[i] + 4. * l.GetValue(xN[0] + h) + y[i + 2]);
     if (result != result) result = 0.;
   }
   return result;
 }
 
-inline double Simpson(std::vector<std::vector<double> > values) {
+inline double Simpson(const std::vector<std::vector<double> >& values) {
   double result = 0.;
   if (values.size() > 2) {
     for (int i = 0; i < values.size()-2; i += 2) {
       double xN[] = {values[i][0], values[i+1][0], values[i+2][0]};
       double yN[] = {values[i][1], values[i+1][1], values[i+2][1]};
       double h = (xN[2] - xN[0]) / 2.;
-      Lagrange* l = new Lagrange(xN, yN);
-      result += 1. / 3. * h * (values[i][1] + 4. * l->GetValue(xN[0] + h) + values[i + 2][1]);
+      Lagrange l(xN, yN);
+      result += 1. / 3. * h * (values[i][1] + 4. * l.GetValue(xN[0] + h) + values[i + 2][1]);
+      if (result != result) result = 0.;
+    }
+  }
+  return result;
+}
+
+/**
+ * Perform Simpson integration
+ *
+ * @param x vector of x values
+ * @param y vector of y values, of the same size as x
+ */
+inline double Simpson(const std::vector<double>& x, const std::vector<double>& y) {
+  double result = 0.;
+  if (x.size() > 2) {
+    for (std::size_t i = 0; i < x.size() - 2; i += 2) {
+      double xN[] = {x[i], x[i + 1], x[i + 2]};
+      double yN[] = {y[i], y[i + 1], y[i + 2]};
+      double h = (xN[2] - xN[0]) / 2.;
+      Lagrange l(xN, yN);
+      result += 1. / 3. * h * (y[i] + 4. * l.GetValue(xN[0] + h) + y[i + 2]);
       if (result != result) result = 0.;
     }
   }
@@ -3,22 +3,19 @@
 #include "BSGConfig.h"
 
 #include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
 
 #include <iostream>
+#include <vector>
 
 using std::cout;
 using std::endl;
 
-po::options_description bsg::BSGOptionContainer::genericOptions("Generic options");
-po::options_description bsg::BSGOptionContainer::spectrumOptions(
-    "Spectrum shape options");
-po::options_description bsg::BSGOptionContainer::configOptions(
-    "Spectral configuration file options");
-po::options_description bsg::BSGOptionContainer::transitionOptions(
-    "Transition information");
-po::variables_map bsg::BSGOptionContainer::vm;
-
-bsg::BSGOptionContainer::BSGOptionContainer(int argc, char** argv) {
+bsg::BSGOptionContainer::BSGOptionContainer(int argc, char** argv, const OptionValues* values)
+    : genericOptions("Generic options"),
+      spectrumOptions("Spectrum shape options"),
+      configOptions("Spectral configuration file options"),
+      transitionOptions("Transition information") {
   transitionOptions.add_options()("Transition.Process",
                                   po::value<std::string>(),
                                   "Set the decay process: B+, B-")(
@@ -90,6 +87,11 @@ bsg::BSGOptionContainer::BSGOptionContainer(int argc, char** argv) {
       "Turn off relativistic corrections.")(
       "Spectrum.ESDeformation,D", po::value<bool>()->default_value(true),
       "Turn off deformation corrections.")(
+      "Spectrum.ESDeformationTolerance", po::value<double>()->default_value(0.),
+      "Calculate the deformation correction exactly only on an adaptive set of "
+      "nodes and interpolate in between, with the given relative tolerance, "
+      "which is checked at the interval midpoints and is an estimate rather "
+      "than a bound. When 0, it is calculated exactly at every energy.")(
       "Spectrum.U,U", po::value<bool>()->default_value(true),
       "Turn off U correction.")(
       "Spectrum.CoulombRecoil,Q", po::value<bool>()->default_value(true),
@@ -121,8 +123,22 @@ bsg::BSGOptionContainer::BSGOptionContainer(int argc, char** argv) {
       "Specify the stepsize in keV.")(
       "Spectrum.Steps,N", po::value<int>(),
       "Specify the number of steps in the total spectrum")(
+      "Spectrum.EnergyList", po::value<std::string>(),
+      "Specify a file with the kinetic energies in keV at which to calculate "
+      "the spectrum, instead of Spectrum.Begin, End, StepSize and Steps. The "
+      "energies are sorted, and those outside of [0, Q] are skipped.")(
+      "Spectrum.BinEdges", po::value<std::string>(),
+      "Specify a file with ascending bin edges in keV. The spectrum is "
+      "integrated over every bin and written to the .bins file.")(
+      "Spectrum.BinOrder", po::value<int>()->default_value(8),
+      "Set the number of Gauss-Legendre nodes per bin for Spectrum.BinEdges.")(
       "Spectrum.Neutrino,v", po::value<bool>()->default_value(true),
       "Turn off the generation of the neutrino spectrum.")(
+      "Spectrum.SymmetricGrid", po::value<bool>()->default_value(false),
+      "Use a grid from Spectrum.Begin to the endpoint minus Spectrum.Begin "
+      "so that the neutrino energies coincide with grid points and corrections "
+      "with the same form for electron and neutrino are calculated only once. "
+      "Requires Spectrum.End to be 0.")(
       "Spectrum.Connect", po::value<bool>()->default_value(false),
       "Turn on the connection between BSG and NME for the calculation the C_I "
       "correction, thereby using the single particle states from the latter")(
@@ -160,10 +176,69 @@ bsg::BSGOptionContainer::BSGOptionContainer(int argc, char** argv) {
       "Specify input file containing transition and nuclear data")(
       "output,o", po::value<std::string>()->default_value("output"),
       "Specify the output file name.")(
+      "threads", po::value<int>()->default_value(1),
+      "Set the number of threads used to evaluate the spectrum. Use 0 to "
+      "match the number of available cores.")(
+      "stream",
+      "Do not keep the spectrum in memory, but only write it to the raw output "
+      "file while accumulating the integrals.")(
+      "breakdown",
+      "Store the factor of every correction separately, so that the spectrum "
+      "can be recomposed with corrections turned off, and write them to the "
+      ".breakdown file.")(
+      "stdout",
+      "Stream the spectrum to standard output in frames while it is being "
+      "calculated, in the form chosen by --format (text or binary). Implies "
+      "--stream. Messages are written to standard error instead.")(
+      "format", po::value<std::string>()->default_value("text"),
+      "Set the format of the raw spectrum output: text (.raw), binary "
+      "(.bin, a memory-mappable columnar file read by bsg::SpectrumFile) or "
+      "root (appended to the file given by --rootfile).")(
+      "rootfile", po::value<std::string>()->default_value("bsg.root"),
+      "Set the ROOT file to which spectra and their summaries are appended "
+      "with --format root.")(
+      "checkpoint", po::value<double>()->default_value(0.),
+      "Write the completed part of the spectrum and its integrals to the "
+      ".ckpt file at most every given number of seconds, so that the "
+      "calculation can be continued with --resume. Use 0 to turn off.")(
+      "resume",
+      "Continue from the .ckpt file of a previous run with the same options, "
+      "or start from the beginning when there is none.")(
+      "cache-dir", po::value<std::string>()->default_value(""),
+      "Set the directory in which finished results are kept, so that an "
+      "identical calculation is not repeated. Defaults to bsg in "
+      "$XDG_CACHE_HOME or ~/.cache.")(
+      "cache-size", po::value<double>()->default_value(1024.),
+      "Set the size of the result cache in MB, above which the least "
+      "recently used results are removed.")(
+      "no-cache", "Do not use the result cache.")(
+      "batch", po::value<std::string>(),
+      "Run all calculations listed in the given manifest file in this "
+      "process. Every line names an input file, optionally followed by a "
+      "configuration file (- for the one given by --config) and an output "
+      "name. The other options apply to all calculations, and a report is "
+      "written to the .batch file named by --output.")(
+      "table", po::value<std::string>(),
+      "Run a calculation for every row of the given CSV or TSV file in this "
+      "process, like --batch. The header names the options, e.g. Mother.Z or "
+      "Spectrum.WeakMagnetism, and an optional output column the output "
+      "names. Empty cells leave an option unset for that row.")(
+      "jobs", po::value<int>()->default_value(0),
+      "Set the number of calculations of a batch run at the same time. Use "
+      "0 to match the number of available cores.")(
+      "log-level", po::value<std::string>()->default_value("info"),
+      "Set the lowest level written to the log file: trace, debug, info, "
+      "warning, error, critical or off.")(
+      "no-log-files", "Do not create the log file.")(
       "version", "Show the current version");
 
   ParseCmdLineOptions(argc, argv);
 
+  if (vm.count("stdout") && !spdlog::get("stderr")) {
+    // keep standard output free for the spectrum
+    spdlog::set_default_logger(spdlog::stderr_color_mt("stderr"));
+  }
+
   if (vm.count("version")) {
     cout << "***********************************" << endl;
     cout << "BSG version: " << BSG_VERSION << endl;
@@ -183,10 +258,17 @@ bsg::BSGOptionContainer::BSGOptionContainer(int argc, char** argv) {
     cout << "\n\n**************************************************************"
             "*\n\n" << endl;
     cout << configOptions << endl;
-  } else {
+  } else if (values) {
+    // stored first, so that they take precedence over the configuration file,
+    // which is optional here
+    ParseValues(*values);
+    if (!configName.empty()) ParseConfigOptions(configName);
+    nmeOptions = nme::NMEOptionContainer(argc, argv, values).GetOptions();
+  } else if (!vm.count("batch") && !vm.count("table")) {
+    // the files of a batch are named per calculation in its manifest or table
     ParseConfigOptions(configName);
     ParseInputOptions(inputName);
-    nme::NMEOptionContainer::GetInstance(argc, argv);
+    nmeOptions = nme::NMEOptionContainer(argc, argv).GetOptions();
   }
 }
 
@@ -226,3 +308,23 @@ void bsg::BSGOptionContainer::ParseInputOptions(std::string inputName) {
   }
   po::notify(vm);
 }
+
+void bsg::BSGOptionContainer::ParseValues(const OptionValues& values) {
+  po::options_description valueOptions;
+  valueOptions.add(transitionOptions).add(configOptions);
+  po::store(nme::ParseOptionValues(values, valueOptions), vm);
+  po::notify(vm);
+}
+
+std::vector<std::string> bsg::BSGOptionContainer::GetArguments(int argc, char** argv,
+                                                            const std::set<std::string>& exclude) {
+  po::options_description cmdOptions;
+  cmdOptions.add(genericOptions).add(configOptions);
+  po::parsed_options parsed = po::command_line_parser(argc, argv).options(cmdOptions).allow_unregistered().run();
+  std::vector<std::string> arguments;
+  for (const auto& option : parsed.options) {
+    if (exclude.count(option.string_key)) continue;
+    arguments.insert(arguments.end(), option.original_tokens.begin(), option.original_tokens.end());
+  }
+  return arguments;
+}
@@ -0,0 +1,44 @@
+#include "BSGOptions.h"
+
+#include <set>
+#include <sstream>
+#include <vector>
+
+std::string bsg::BSGOptions::GetOptionsString() const {
+  static const std::set<std::string> runControl = {
+      "help", "version", "config", "input", "output", "threads", "stream", "breakdown", "stdout", "format", "rootfile",
+      "checkpoint", "resume", "cache-dir", "cache-size", "no-cache", "batch", "table", "jobs", "log-level",
+      "no-log-files"};
+
+  std::ostringstream dump;
+  dump.precision(17);
+  // the variables map is ordered by name, so the dump does not depend on
+  // the order in which the options were given
+  for (const auto& option : *vm) {
+    if (runControl.count(option.first)) continue;
+    const boost::any& value = option.second.value();
+    dump << option.first << "=";
+    if (const double* d = boost::any_cast<double>(&value)) dump << *d;
+    else if (const int* i = boost::any_cast<int>(&value)) dump << *i;
+    else if (const bool* b = boost::any_cast<bool>(&value)) dump << *b;
+    else if (const std::string* str = boost::any_cast<std::string>(&value)) dump << *str;
+    else if (const std::vector<double>* v = boost::any_cast<std::vector<double> >(&value)) {
+      for (double x : *v) dump << x << ",";
+    }
+    dump << "\n";
+  }
+  // options only known to NME, such as the computational settings of the nuclear structure
+  std::set<std::string> known(runControl);
+  for (const auto& option : *vm) known.insert(option.first);
+  dump << nmeOptions.GetOptionsString(known);
+  return dump.str();
+}
+
+std::uint64_t bsg::BSGOptions::GetOptionsHash() const {
+  std::uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : GetOptionsString()) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
@@ -0,0 +1,398 @@
+#include "Batch.h"
+#include "Generator.h"
+#include "ResultCache.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#include "boost/algorithm/string.hpp"
+#include "spdlog/fmt/fmt.h"
+#include "spdlog/spdlog.h"
+
+namespace {
+/**
+ * Name of a file without its directory and extension
+ */
+std::string GetStem(const std::string& fileName) {
+  std::size_t begin = fileName.find_last_of('/');
+  begin = begin == std::string::npos ? 0 : begin + 1;
+  std::size_t end = fileName.find_last_of('.');
+  return fileName.substr(begin, end == std::string::npos || end < begin ? std::string::npos : end - begin);
+}
+}
+
+bool bsg::SplitRow(const std::string& line, char delimiter, std::vector<std::string>& cells) {
+  cells.clear();
+  std::size_t i = 0;
+  while (true) {
+    std::string cell;
+    while (i < line.size() && line[i] != delimiter && std::isspace((unsigned char)line[i])) i++;
+    if (i < line.size() && line[i] == '"') {
+      for (i++;; i++) {
+        if (i == line.size()) return false;
+        if (line[i] == '"') {
+          if (i + 1 < line.size() && line[i + 1] == '"') {
+            i++;
+          } else {
+            break;
+          }
+        }
+        cell += line[i];
+      }
+      i++;
+      while (i < line.size() && line[i] != delimiter) i++;
+    } else {
+      std::size_t end = line.find(delimiter, i);
+      if (end == std::string::npos) end = line.size();
+      cell = boost::trim_copy(line.substr(i, end - i));
+      i = end;
+    }
+    cells.push_back(cell);
+    if (i >= line.size()) return true;
+    i++;
+  }
+}
+
+std::string bsg::CheckTransition(const BSGOptions& options) {
+  for (const char* name : {"Transition.Process", "Mother.Z", "Mother.A", "Daughter.Z", "Daughter.A"}) {
+    if (!options.Exists(name)) return std::string("missing option ") + name;
+  }
+  if (options.Get<int>("Mother.A") != options.Get<int>("Daughter.A")) {
+    return "mother and daughter mass numbers differ";
+  }
+  int betaType = boost::iequals(options.Get<std::string>("Transition.Process"), "B+") ? -1 : 1;
+  if (options.Get<int>("Daughter.Z") != options.Get<int>("Mother.Z") + betaType) {
+    return "mother and daughter cannot be connected through process " + options.Get<std::string>("Transition.Process");
+  }
+  return "";
+}
+
+double bsg::EstimateCost(const BSGOptions& options) {
+  double points = 1.;
+  if (options.Exists("Spectrum.EnergyList")) {
+    std::vector<double> energies;
+    utilities::ReadValues(options.Get<std::string>("Spectrum.EnergyList"), energies);
+    points = energies.size();
+  } else if (options.Exists("Spectrum.Steps")) {
+    points = options.Get<int>("Spectrum.Steps");
+  } else if (options.Exists("Transition.QValue") && options.Get<double>("Spectrum.StepSize") > 0.) {
+    double end = options.Get<double>("Spectrum.End");
+    if (end <= 0.) end = options.Get<double>("Transition.QValue");
+    points = (end - options.Get<double>("Spectrum.Begin")) / options.Get<double>("Spectrum.StepSize");
+  }
+  double cost = std::max(1., points);
+  if (options.Get<bool>("Spectrum.ESDeformation")) {
+    cost *= BATCH_DEFORMATION_FACTOR;
+  }
+
+  std::string potential = options.GetNMEOptions().Get<std::string>("Computational.Potential");
+  if (boost::iequals(potential, "WS")) {
+    cost += BATCH_WS_COST;
+  } else if (boost::iequals(potential, "DWS")) {
+    cost += BATCH_DWS_COST;
+    if (options.Get<bool>("Spectrum.Connect")) cost += BATCH_CONNECT_COST;
+  }
+  return cost;
+}
+
+bsg::BatchRunner::BatchRunner(int argc, char** argv, BSGOptionContainer& container)
+    : program(argc > 0 ? argv[0] : "bsg_exec"), delimiter(','), tableLine(0), tableRow(0), nJobs(0), cacheReported(false) {
+  if (container.Exists("config")) {
+    config = container.GetBSGOption<std::string>("config");
+  }
+  // options that are given per job, or only concern the batch itself
+  sharedArguments = container.GetArguments(argc, argv, {"help", "version", "input", "config", "output", "batch",
+                                                        "table", "jobs"});
+}
+
+bool bsg::BatchRunner::ReadManifest(std::string fileName) {
+  error.clear();
+  std::ifstream manifest(fileName.c_str());
+  if (!manifest.is_open()) {
+    error = "Cannot read batch manifest " + fileName;
+    return false;
+  }
+  std::set<std::string> outputs;
+  std::string line;
+  for (int lineNumber = 1; std::getline(manifest, line); lineNumber++) {
+    std::istringstream stream(line);
+    std::vector<std::string> fields;
+    std::string field;
+    while (stream >> field) fields.push_back(field);
+    if (fields.empty() || fields[0][0] == '#') continue;
+    if (fields.size() > 3) {
+      error = fmt::format("{}:{}: expected an input file, configuration file and output name", fileName, lineNumber);
+      return false;
+    }
+
+    BatchJob job = {fields[0], 0, OptionValues(), config, "", 0., "", 0.};
+    if (fields.size() > 1 && fields[1] != "-") {
+      job.config = fields[1];
+    }
+    job.output = fields.size() > 2 ? fields[2] : GetStem(job.input);
+    // the output files of jobs that run at the same time must not overlap
+    if (!outputs.insert(job.output).second) {
+      error = fmt::format("{}:{}: output name {} is used more than once", fileName, lineNumber, job.output);
+      return false;
+    }
+    jobs.push_back(job);
+  }
+  return true;
+}
+
+bool bsg::BatchRunner::OpenTable(std::string fileName) {
+  error.clear();
+  jobs.clear();
+  tableName = fileName;
+  tableStem = GetStem(fileName);
+  tableLine = 0;
+  tableRow = 0;
+  table.open(fileName.c_str());
+  if (!table.is_open()) {
+    error = "Cannot read batch table " + fileName;
+    return false;
+  }
+  std::string line;
+  while (std::getline(table, line)) {
+    tableLine++;
+    boost::trim(line);
+    if (line.empty() || line[0] == '#') continue;
+    delimiter = line.find('\t') != std::string::npos ? '\t' : ',';
+    if (!SplitRow(line, delimiter, columns)) {
+      error = fmt::format("{}:{}: quote is not closed", fileName, tableLine);
+      return false;
+    }
+    std::set<std::string> names;
+    for (const auto& name : columns) {
+      if (name.empty() || !names.insert(name).second) {
+        error = fmt::format("{}:{}: column names must be unique and not empty", fileName, tableLine);
+        return false;
+      }
+    }
+    return true;
+  }
+  error = "Batch table " + fileName + " has no header";
+  return false;
+}
+
+bool bsg::BatchRunner::ReadRows(std::size_t maxRows) {
+  std::set<std::string> outputs;
+  std::string line;
+  std::vector<std::string> cells;
+  while (jobs.size() < maxRows && std::getline(table, line)) {
+    tableLine++;
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    std::size_t first = line.find_first_not_of(" \t");
+    if (first == std::string::npos || line[first] == '#') continue;
+    tableRow++;
+
+    BatchJob job = {tableName, tableLine, OptionValues(), config, "", 0., "", 0.};
+    job.output = fmt::format("{}_{}", tableStem, tableRow);
+    if (!SplitRow(line, delimiter, cells)) {
+      job.status = "failed: quote is not closed";
+    } else if (cells.size() != columns.size()) {
+      job.status = fmt::format("failed: expected {} cells, found {}", columns.size(), cells.size());
+    }
+    for (std::size_t i = 0; job.status.empty() && i < cells.size(); i++) {
+      if (cells[i].empty()) continue;
+      if (columns[i] == "output") {
+        job.output = cells[i];
+      } else {
+        job.values.push_back(std::make_pair(columns[i], cells[i]));
+      }
+    }
+    // the output files of jobs that run at the same time must not overlap
+    if (job.status.empty() && !outputs.insert(job.output).second) {
+      job.status = "failed: output name is used by another row";
+    }
+    jobs.push_back(job);
+  }
+  return !jobs.empty();
+}
+
+std::vector<std::string> bsg::BatchRunner::GetArguments(const BatchJob& job) const {
+  std::vector<std::string> arguments = {program, "--output", job.output};
+  if (job.line == 0) {
+    arguments.push_back("--input");
+    arguments.push_back(job.input);
+  }
+  if (!job.config.empty()) {
+    arguments.push_back("--config");
+    arguments.push_back(job.config);
+  }
+  arguments.insert(arguments.end(), sharedArguments.begin(), sharedArguments.end());
+  return arguments;
+}
+
+int bsg::BatchRunner::Run(int nWorkers, std::string reportName) {
+  if (nWorkers <= 0) {
+    nWorkers = std::max(1, (int)std::thread::hardware_concurrency());
+  }
+  std::ofstream report((reportName + ".batch").c_str());
+  report << "# output\tinput\tconfig\testimated cost\tseconds\tstatus\n";
+
+  nJobs = 0;
+  int failed = 0;
+  // a manifest is run as a whole, a table one window at a time
+  bool more = table.is_open() ? ReadRows(BATCH_TABLE_WINDOW) : !jobs.empty();
+  while (more) {
+    RunJobs(nWorkers);
+    WriteReport(report);
+    nJobs += jobs.size();
+    failed += std::count_if(jobs.begin(), jobs.end(),
+                            [](const BatchJob& j) { return j.status != "done" && j.status != "cached"; });
+    jobs.clear();
+    more = table.is_open() && ReadRows(BATCH_TABLE_WINDOW);
+  }
+
+  if (!report) {
+    error = "Cannot write " + reportName + ".batch";
+  }
+  return failed;
+}
+
+void bsg::BatchRunner::RunJobs(int nWorkers) {
+  // the options are parsed up front, as the option containers write to the default logger
+  std::vector<BSGOptions> options(jobs.size());
+  std::vector<std::size_t> order;
+  for (std::size_t i = 0; i < jobs.size(); i++) {
+    if (!jobs[i].status.empty()) continue;
+    try {
+      std::vector<std::string> arguments = GetArguments(jobs[i]);
+      std::vector<char*> argv;
+      for (auto& a : arguments) argv.push_back(&a[0]);
+      if (jobs[i].line > 0) {
+        options[i] = BSGOptionContainer((int)argv.size(), argv.data(), &jobs[i].values).GetOptions();
+        OptionValues().swap(jobs[i].values);
+      } else {
+        options[i] = BSGOptionContainer((int)argv.size(), argv.data()).GetOptions();
+      }
+      std::string problem = CheckTransition(options[i]);
+      if (!problem.empty()) {
+        jobs[i].status = "failed: " + problem;
+        continue;
+      }
+      jobs[i].cost = EstimateCost(options[i]);
+      order.push_back(i);
+    } catch (std::exception& e) {
+      jobs[i].status = std::string("failed: ") + e.what();
+    }
+  }
+  // the cache options are shared by all jobs
+  if (!cacheReported && !order.empty()) {
+    ResultCache cache = ResultCache::FromOptions(options[order[0]]);
+    if (cache.IsEnabled()) {
+      spdlog::info("Using the result cache in {} of at most {} MB (disable with --no-cache)", cache.GetDirectory(),
+                   cache.GetMaxBytes() / (1024 * 1024));
+    }
+    cacheReported = true;
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [this](std::size_t a, std::size_t b) { return jobs[a].cost > jobs[b].cost; });
+  nWorkers = std::max(1, std::min(nWorkers, (int)order.size()));
+  std::vector<Queue> queues(nWorkers);
+  for (std::size_t i : order) {
+    auto least = std::min_element(queues.begin(), queues.end(),
+                                  [](const Queue& a, const Queue& b) { return a.cost < b.cost; });
+    least->jobs.push_back(i);
+    least->cost += jobs[i].cost;
+  }
+
+  auto worker = [&](std::size_t w) {
+    std::size_t job;
+    while (NextJob(queues, w, job)) {
+      RunJob(jobs[job], options[job]);
+    }
+  };
+  if (nWorkers == 1) {
+    worker(0);
+  } else {
+    std::vector<std::thread> threads;
+    for (int w = 0; w < nWorkers; w++) {
+      threads.push_back(std::thread(worker, w));
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+}
+
+bool bsg::BatchRunner::NextJob(std::vector<Queue>& queues, std::size_t worker, std::size_t& job) {
+  {
+    Queue& own = queues[worker];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.jobs.empty()) {
+      job = own.jobs.front();
+      own.jobs.pop_front();
+      own.cost -= jobs[job].cost;
+      return true;
+    }
+  }
+  // no job can be added, so the batch is finished once all queues are empty
+  while (true) {
+    Queue* victim = nullptr;
+    double most = -1.;
+    for (auto& q : queues) {
+      std::lock_guard<std::mutex> lock(q.mutex);
+      if (!q.jobs.empty() && q.cost > most) {
+        victim = &q;
+        most = q.cost;
+      }
+    }
+    if (!victim) return false;
+    std::lock_guard<std::mutex> lock(victim->mutex);
+    // may have been emptied by its owner in the meantime
+    if (!victim->jobs.empty()) {
+      job = victim->jobs.back();
+      victim->jobs.pop_back();
+      victim->cost -= jobs[job].cost;
+      return true;
+    }
+  }
+}
+
+void bsg::BatchRunner::RunJob(BatchJob& job, const BSGOptions& options) {
+  auto start = std::chrono::steady_clock::now();
+  try {
+    ResultCache cache = ResultCache::FromOptions(options);
+    std::string key = cache.IsEnabled() ? ResultCache::GetKey(options) : "";
+    if (cache.Fetch(key, job.output)) {
+      job.status = "cached";
+    } else {
+      std::string outputError;
+      std::vector<std::string> files;
+      {
+        Generator gen(options);
+        gen.CalculateSpectrum();
+        outputError = gen.GetOutputError();
+        files = gen.GetOutputFiles();
+        // the output files are closed with the generator
+      }
+      if (outputError.empty()) {
+        cache.Store(key, job.output, files);
+        job.status = "done";
+      } else {
+        job.status = "failed: " + outputError;
+      }
+    }
+  } catch (std::exception& e) {
+    job.status = std::string("failed: ") + e.what();
+  }
+  job.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void bsg::BatchRunner::WriteReport(std::ostream& report) const {
+  for (const auto& job : jobs) {
+    std::string input = job.line > 0 ? fmt::format("{}:{}", job.input, job.line) : job.input;
+    report << fmt::format("{}\t{}\t{}\t{:.0f}\t{:.3f}\t{}\n", job.output, input,
+                          job.config.empty() ? "-" : job.config, job.cost, job.seconds, job.status);
+  }
+  report.flush();
+}
@@ -0,0 +1,164 @@
+#include "Checkpoint.h"
+#include "SpectrumFile.h"
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+/**
+ * FNV-1a hash of the header, up to its checksum
+ */
+std::uint64_t HeaderChecksum(const bsg::CheckpointHeader& header) {
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&header);
+  std::uint64_t hash = 14695981039346656037ULL;
+  for (std::size_t i = 0; i < offsetof(bsg::CheckpointHeader, checksum); i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+bool IsValid(const bsg::CheckpointHeader& header) {
+  return std::memcmp(header.magic, bsg::CHECKPOINT_MAGIC, sizeof(bsg::CHECKPOINT_MAGIC)) == 0 &&
+         header.version == bsg::CHECKPOINT_VERSION &&
+         header.byteOrder == bsg::SPECTRUM_FILE_BYTE_ORDER && header.checksum == HeaderChecksum(header);
+}
+}
+
+bsg::Checkpoint::Checkpoint(std::string _fileName)
+    : fileName(_fileName), file(nullptr), nAppended(0) {
+  std::memset(&header, 0, sizeof(header));
+}
+
+bsg::Checkpoint::~Checkpoint() { Close(); }
+
+bool bsg::Checkpoint::Create(std::uint64_t optionsHash, std::uint64_t nTotal) {
+  Close();
+  error.clear();
+  file = std::fopen(fileName.c_str(), "w+b");
+  if (!file) {
+    error = "cannot create " + fileName;
+    return false;
+  }
+  // zero both slots, so that only the one written below is valid
+  std::vector<char> zeros(CHECKPOINT_DATA_OFFSET, 0);
+  std::fwrite(zeros.data(), 1, zeros.size(), file);
+
+  // zero the padding too, as it is part of the checksum
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+  header.version = CHECKPOINT_VERSION;
+  header.byteOrder = SPECTRUM_FILE_BYTE_ORDER;
+  header.optionsHash = optionsHash;
+  header.nTotal = nTotal;
+  SpectrumMoments empty;
+  header.moments = empty.GetState();
+  nAppended = 0;
+  return WriteHeader();
+}
+
+bool bsg::Checkpoint::Resume(std::uint64_t optionsHash, std::uint64_t nTotal, Spectrum& prefix,
+                             SpectrumMoments::State& moments) {
+  Close();
+  error.clear();
+  file = std::fopen(fileName.c_str(), "r+b");
+  if (!file) {
+    error = "cannot open " + fileName;
+    return false;
+  }
+
+  CheckpointHeader slots[2];
+  bool valid[2];
+  for (int i = 0; i < 2; i++) {
+    valid[i] = fseeko(file, i * CHECKPOINT_SLOT_SIZE, SEEK_SET) == 0 &&
+               std::fread(&slots[i], sizeof(CheckpointHeader), 1, file) == 1 && IsValid(slots[i]);
+  }
+  if (!valid[0] && !valid[1]) {
+    error = fileName + " is not a valid BSG checkpoint";
+  } else {
+    header = slots[valid[1] && (!valid[0] || slots[1].sequence > slots[0].sequence) ? 1 : 0];
+    if (header.optionsHash != optionsHash) {
+      error = fileName + " was written with different options";
+    } else if (header.nTotal != nTotal || header.nDone > nTotal) {
+      error = fileName + " was written for a different energy grid";
+    }
+  }
+
+  std::vector<double> rows(3 * header.nDone);
+  if (error.empty() && (fseeko(file, CHECKPOINT_DATA_OFFSET, SEEK_SET) != 0 ||
+                        std::fread(rows.data(), sizeof(double), rows.size(), file) != rows.size())) {
+    error = fileName + " is truncated";
+  }
+  if (!error.empty()) {
+    Close();
+    return false;
+  }
+
+  prefix.Resize(header.nDone);
+  for (std::size_t i = 0; i < header.nDone; i++) {
+    prefix.GetW()[i] = rows[3 * i];
+    prefix.GetElectron()[i] = rows[3 * i + 1];
+    prefix.GetNeutrino()[i] = rows[3 * i + 2];
+  }
+  moments = header.moments;
+  // points appended after the last commit are overwritten
+  nAppended = header.nDone;
+  return true;
+}
+
+bool bsg::Checkpoint::Append(const double W[], const double electron[], const double neutrino[],
+                             std::size_t size) {
+  if (!file) return false;
+  std::vector<double> rows(3 * size);
+  for (std::size_t i = 0; i < size; i++) {
+    rows[3 * i] = W[i];
+    rows[3 * i + 1] = electron[i];
+    rows[3 * i + 2] = neutrino[i];
+  }
+  if (fseeko(file, CHECKPOINT_DATA_OFFSET + nAppended * 3 * sizeof(double), SEEK_SET) != 0 ||
+      std::fwrite(rows.data(), sizeof(double), rows.size(), file) != rows.size()) {
+    error = "cannot write to " + fileName;
+    return false;
+  }
+  nAppended += size;
+  return true;
+}
+
+bool bsg::Checkpoint::Commit(const SpectrumMoments::State& moments) {
+  if (!file) return false;
+  // the points have to be on disk before a header refers to them
+  if (std::fflush(file) != 0 || fsync(fileno(file)) != 0) {
+    error = "cannot write to " + fileName;
+    return false;
+  }
+  header.nDone = nAppended;
+  header.moments = moments;
+  header.sequence++;
+  return WriteHeader();
+}
+
+bool bsg::Checkpoint::WriteHeader() {
+  header.checksum = HeaderChecksum(header);
+  if (fseeko(file, (header.sequence % 2) * CHECKPOINT_SLOT_SIZE, SEEK_SET) != 0 ||
+      std::fwrite(&header, sizeof(header), 1, file) != 1 || std::fflush(file) != 0 ||
+      fsync(fileno(file)) != 0) {
+    error = "cannot write to " + fileName;
+    return false;
+  }
+  return true;
+}
+
+void bsg::Checkpoint::Close() {
+  if (file) {
+    std::fclose(file);
+  }
+  file = nullptr;
+}
+
+void bsg::Checkpoint::Remove() {
+  Close();
+  std::remove(fileName.c_str());
+}
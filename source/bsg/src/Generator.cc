@@ -3,16 +3,31 @@
 #include "spdlog/sinks/stdout_color_sinks.h"
 
 #include "BSGOptionContainer.h"
+#include "Logging.h"
 #include "ChargeDistributions.h"
 #include "Constants.h"
 #include "Utilities.h"
 #include "SpectralFunctions.h"
+#include "SpectrumWriter.h"
+#include "RootSpectrumWriter.h"
+#include "Checkpoint.h"
 
 #include <iostream>
 #include <stdio.h>
 #include <vector>
 #include <cmath>
 #include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <exception>
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <map>
+#include <functional>
+#include <set>
 
 #include "boost/algorithm/string.hpp"
 
@@ -25,9 +40,100 @@ namespace NS = nme::NuclearStructure;
 using std::cout;
 using std::endl;
 
-void ShowBSGInfo() {
+/**
+ * Number of consecutive grid points handed to a thread at once
+ */
+const std::size_t GRID_CHUNK_SIZE = 64;
+
+/**
+ * Number of grid points kept in memory at once when streaming
+ */
+const std::size_t STREAM_BLOCK_SIZE = 256 * GRID_CHUNK_SIZE;
+
+/**
+ * Wall time in seconds since start
+ */
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Fit of CD::FitHODist, which depends only on Z and the RMS radius. The fits
+ * are kept for the lifetime of the process, as they take long compared to
+ * the rest of the set-up of a Generator.
+ */
+double GetHOFit(int Z, double rms) {
+  static std::map<std::pair<int, double>, double> fits;
+  static std::mutex mutex;
+  auto key = std::make_pair(Z, rms);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = fits.find(key);
+    if (it != fits.end()) return it->second;
+  }
+  double fit = CD::FitHODist(Z, rms);
+  std::lock_guard<std::mutex> lock(mutex);
+  fits[key] = fit;
+  return fit;
+}
+
+/**
+ * Atomic exchange parameters per proton number, read once per file and kept
+ * for the lifetime of the process. Of lines with the same proton number, the
+ * last one is used.
+ *
+ * @param fileName name of the exchange parameter file
+ * @returns nullptr when the file cannot be read
+ */
+const std::map<int, std::array<double, 9> >* GetExchangeTable(const std::string& fileName) {
+  static std::map<std::string, std::map<int, std::array<double, 9> > > tables;
+  static std::mutex mutex;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = tables.find(fileName);
+  if (it != tables.end()) return &it->second;
+
+  std::ifstream paramStream(fileName.c_str());
+  if (!paramStream.is_open()) return nullptr;
+  std::map<int, std::array<double, 9> >& table = tables[fileName];
+  std::string line;
+  while (getline(paramStream, line)) {
+    double z;
+    std::array<double, 9> pars;
+    std::istringstream iss(line);
+    iss >> z;
+    for (double& p : pars) iss >> p;
+    if (iss && z == std::floor(z)) table[(int)z] = pars;
+  }
+  return &table;
+}
+
+/**
+ * JSON representation of a number, null when it is not finite
+ */
+std::string JsonNumber(double x) {
+  return std::isfinite(x) ? fmt::format("{}", x) : "null";
+}
+
+/**
+ * JSON representation of a string
+ */
+std::string JsonString(const std::string& s) {
+  std::string quoted = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+      quoted += c;
+    } else if ((unsigned char)c < 0x20) {
+      quoted += fmt::format("\\u{:04x}", (int)c);
+    } else {
+      quoted += c;
+    }
+  }
+  return quoted + "\"";
+}
+
+void ShowBSGInfo(std::shared_ptr<spdlog::logger> logger) {
   std::string author = "L. Hayen (leendert.hayen@kuleuven.be)";
-  auto logger = spdlog::get("BSG_results_file");
   logger->info("{:*>60}", "");
   logger->info("{:^60}", "BSG v" + std::string(BSG_VERSION));
   logger->info("{:^60}", "Last update: " + std::string(BSG_LAST_UPDATE));
@@ -35,22 +141,31 @@ void ShowBSGInfo() {
   logger->info("{:*>60}\n", "");
 }
 
-bsg::Generator::Generator() {
+bsg::Generator::Generator() : Generator(BSGOptionContainer::GetInstance().GetOptions()) {}
+
+bsg::Generator::Generator(const BSGOptions& _options) : options(_options) {
   InitializeLoggers();
+  auto start = std::chrono::steady_clock::now();
   InitializeConstants();
   InitializeShapeParameters();
   InitializeL0Constants();
-  if (GetBSGOpt(bool, Spectrum.Exchange)) {
+  if (options.Get<bool>("Spectrum.Exchange")) {
     LoadExchangeParameters();
   }
+  phaseTimes.push_back(std::make_pair("constants", SecondsSince(start)));
+  start = std::chrono::steady_clock::now();
   InitializeNSMInfo();
+  phaseTimes.push_back(std::make_pair("nuclear structure", SecondsSince(start)));
+  start = std::chrono::steady_clock::now();
+  InitializeCorrectionPlan();
+  phaseTimes.push_back(std::make_pair("correction plan", SecondsSince(start)));
   debugFileLogger->debug("Leaving Generator constructor");
 }
 
 bsg::Generator::~Generator() { delete nsm; }
 
 void bsg::Generator::InitializeLoggers() {
-  SetOutputName(GetBSGOpt(std::string, output));
+  SetOutputName(options.Get<std::string>("output"));
 
   /**
    * Remove result & log files if they already exist
@@ -58,63 +173,55 @@ void bsg::Generator::InitializeLoggers() {
   if (std::ifstream(outputName + ".log")) std::remove((outputName + ".log").c_str());
   if (std::ifstream(outputName + ".raw")) std::remove((outputName + ".raw").c_str());
   if (std::ifstream(outputName + ".txt")) std::remove((outputName + ".txt").c_str());
+  if (std::ifstream(outputName + ".json")) std::remove((outputName + ".json").c_str());
+  if (std::ifstream(outputName + ".breakdown")) std::remove((outputName + ".breakdown").c_str());
+  if (std::ifstream(outputName + ".bins")) std::remove((outputName + ".bins").c_str());
+  if (std::ifstream(outputName + ".bin")) std::remove((outputName + ".bin").c_str());
+  if (std::ifstream(outputName + ".nme")) std::remove((outputName + ".nme").c_str());
 
-  debugFileLogger = spdlog::get("debug_file");
-  if (!debugFileLogger) {
-    debugFileLogger = spdlog::basic_logger_mt("debug_file", outputName + ".log");
-    debugFileLogger->set_level(spdlog::level::debug);
-  }
+  debugFileLogger = logging::CreateDebugFileLogger(outputName + ".log", options.Get<std::string>("log-level"), !options.Exists("no-log-files"));
   debugFileLogger->debug("Debugging logger created");
-  consoleLogger = spdlog::get("console");
-  if (!consoleLogger) {
-    consoleLogger = spdlog::stdout_color_mt("console");
-    consoleLogger->set_pattern("%v");
-    consoleLogger->set_level(spdlog::level::warn);
-  }
+  // keep standard output free for the spectrum
+  consoleLogger = logging::GetConsoleLogger(options.Exists("stdout"), "%v");
   debugFileLogger->debug("Console logger created");
-  rawSpectrumLogger = spdlog::get("BSG_raw");
-  if (!rawSpectrumLogger) {
-    rawSpectrumLogger = spdlog::basic_logger_mt("BSG_raw", outputName + ".raw");
-    rawSpectrumLogger->set_pattern("%v");
-    rawSpectrumLogger->set_level(spdlog::level::info);
-  }
-  debugFileLogger->debug("Raw spectrum logger created");
-  resultsFileLogger = spdlog::get("BSG_results_file");
-  if (!resultsFileLogger) {
-    resultsFileLogger = spdlog::basic_logger_mt("BSG_results_file", outputName + ".txt");
-    resultsFileLogger->set_pattern("%v");
-    resultsFileLogger->set_level(spdlog::level::info);
-  }
+  resultsFileLogger = logging::CreateFileLogger("BSG_results_file", outputName + ".txt");
+  AddOutputFile("txt");
   debugFileLogger->debug("Results file logger created");
 }
 
+void bsg::Generator::AddOutputFile(const std::string& extension) {
+  if (std::find(outputFiles.begin(), outputFiles.end(), extension) == outputFiles.end()) {
+    outputFiles.push_back(extension);
+  }
+}
+
 void bsg::Generator::InitializeConstants() {
   debugFileLogger->debug("Entered initialize constants");
 
-  Z = GetBSGOpt(int, Daughter.Z);
-  A = GetBSGOpt(int, Daughter.A);
+  Z = options.Get<int>("Daughter.Z");
+  A = options.Get<int>("Daughter.A");
 
-  R = GetBSGOpt(double, Daughter.Radius) * 1e-15 / NATURAL_LENGTH * std::sqrt(5. / 3.);
+  R = options.Get<double>("Daughter.Radius") * 1e-15 / NATURAL_LENGTH * std::sqrt(5. / 3.);
   if (R == 0.0) {
     debugFileLogger->debug("Radius not found. Using standard formula.");
     R = 1.2 * std::pow(A, 1. / 3.) * 1e-15 / NATURAL_LENGTH;
   }
-  motherBeta2 = GetBSGOpt(double, Mother.Beta2);
-  daughterBeta2 = GetBSGOpt(double, Daughter.Beta2);
-  motherSpinParity = GetBSGOpt(int, Mother.SpinParity);
-  daughterSpinParity = GetBSGOpt(int, Daughter.SpinParity);
+  motherBeta2 = options.Get<double>("Mother.Beta2");
+  daughterBeta2 = options.Get<double>("Daughter.Beta2");
+  motherSpinParity = options.Get<int>("Mother.SpinParity");
+  daughterSpinParity = options.Get<int>("Daughter.SpinParity");
 
-  motherExcitationEn = GetBSGOpt(double, Mother.ExcitationEnergy);
-  daughterExcitationEn = GetBSGOpt(double, Daughter.ExcitationEnergy);
+  motherExcitationEn = options.Get<double>("Mother.ExcitationEnergy");
+  daughterExcitationEn = options.Get<double>("Daughter.ExcitationEnergy");
 
-  gA = GetBSGOpt(double, Constants.gA);
-  gP = GetBSGOpt(double, Constants.gP);
-  gM = GetBSGOpt(double, Constants.gM);
+  gA = options.Get<double>("Constants.gA");
+  gP = options.Get<double>("Constants.gP");
+  gM = options.Get<double>("Constants.gM");
 
   debugFileLogger->debug("gP: {}", gP);
 
-  std::string process = GetBSGOpt(std::string, Transition.Process);
-  std::string type = GetBSGOpt(std::string, Transition.Type);
+  std::string process = options.Get<std::string>("Transition.Process");
+  std::string type = options.Get<std::string>("Transition.Type");
 
   if (boost::iequals(process, "B+")) {
     betaType = BETA_PLUS;
@@ -129,19 +236,19 @@ void bsg::Generator::InitializeConstants() {
     decayType = GAMOW_TELLER;
   } else {
     decayType = MIXED;
-    mixingRatio = GetBSGOpt(double, Transition.MixingRatio);
+    mixingRatio = options.Get<double>("Transition.MixingRatio");
   }
 
-  if (A != GetBSGOpt(int, Mother.A)) {
+  if (A != options.Get<int>("Mother.A")) {
     consoleLogger->error("Mother and daughter mass numbers are not the same.");
   }
-  if (Z != GetBSGOpt(int, Mother.Z)+betaType) {
+  if (Z != options.Get<int>("Mother.Z")+betaType) {
     consoleLogger->error("Mother and daughter cannot be obtained through {} process", process);
   }
 
-  QValue = GetBSGOpt(double, Transition.QValue);
+  QValue = options.Get<double>("Transition.QValue");
 
-  atomicEnergyDeficit = GetBSGOpt(double, Transition.AtomicEnergyDeficit);
+  atomicEnergyDeficit = options.Get<double>("Transition.AtomicEnergyDeficit");
 
   if (betaType == BETA_MINUS) {
     W0 = (QValue - atomicEnergyDeficit + motherExcitationEn - daughterExcitationEn) / ELECTRON_MASS_KEV + 1.;
@@ -154,15 +261,15 @@ void bsg::Generator::InitializeConstants() {
 
 void bsg::Generator::InitializeShapeParameters() {
   debugFileLogger->debug("Entered InitializeShapeParameters");
-  if (!BSGOptExists(Spectrum.ModGaussFit)) {
-    hoFit = CD::FitHODist(Z, R * std::sqrt(3. / 5.));
+  if (!options.Exists("Spectrum.ModGaussFit")) {
+    hoFit = GetHOFit(Z, R * std::sqrt(3. / 5.));
   } else {
-    hoFit = GetBSGOpt(double, Spectrum.ModGaussFit);
+    hoFit = options.Get<double>("Spectrum.ModGaussFit");
   }
   debugFileLogger->debug("hoFit: {}", hoFit);
 
-  ESShape = GetBSGOpt(std::string, Spectrum.ESShape);
-  NSShape = GetBSGOpt(std::string, Spectrum.NSShape);
+  ESShape = options.Get<std::string>("Spectrum.ESShape");
+  NSShape = options.Get<std::string>("Spectrum.NSShape");
 
   vOld.resize(3);
   vNew.resize(3);
@@ -175,11 +282,11 @@ void bsg::Generator::InitializeShapeParameters() {
     vNew[1] = -4./3./(3.*hoFit+2)/std::sqrt(M_PI)*std::pow(5.*(2.+5.*hoFit)/2./(2.+3.*hoFit), 3./2.);
     vNew[2] = (2.-7.*hoFit)/5./(3.*hoFit+2)/std::sqrt(M_PI)*std::pow(5.*(2.+5.*hoFit)/2./(2.+3.*hoFit), 5./3.);
   } else {
-    if (BSGOptExists(Spectrum.vold) && BSGOptExists(Spectrum.vnew)) {
+    if (options.Exists("Spectrum.vold") && options.Exists("Spectrum.vnew")) {
       debugFileLogger->debug("Found v and v'");
-      vOld = GetBSGOpt(std::vector<double>, Spectrum.vold);
-      vNew = GetBSGOpt(std::vector<double>, Spectrum.vnew);
-    } else if (BSGOptExists(vold) || BSGOptExists(vnew)) {
+      vOld = options.Get<std::vector<double>>("Spectrum.vold");
+      vNew = options.Get<std::vector<double>>("Spectrum.vnew");
+    } else if (options.Exists("vold") || options.Exists("vnew")) {
       consoleLogger->error("ERROR: Both old and new potential expansions must be given.");
     }
   }
@@ -188,29 +295,13 @@ void bsg::Generator::InitializeShapeParameters() {
 
 void bsg::Generator::LoadExchangeParameters() {
   debugFileLogger->debug("Entered LoadExchangeParameters");
-  std::string exParamFile = GetBSGOpt(std::string, exchangedata);
-  std::ifstream paramStream(exParamFile.c_str());
-  std::string line;
+  std::string exParamFile = options.Get<std::string>("exchangedata");
+  const std::map<int, std::array<double, 9> >* table = GetExchangeTable(exParamFile);
 
-  if (paramStream.is_open()) {
-    while (getline(paramStream, line)) {
-      double z;
-      double a, b, c, d, e, f, g, h, i;
-
-      std::istringstream iss(line);
-      iss >> z >> a >> b >> c >> d >> e >> f >> g >> h >> i;
-
-      if (z == Z - betaType) {
-        exPars[0] = a;
-        exPars[1] = b;
-        exPars[2] = c;
-        exPars[3] = d;
-        exPars[4] = e;
-        exPars[5] = f;
-        exPars[6] = g;
-        exPars[7] = h;
-        exPars[8] = i;
-      }
+  if (table) {
+    auto it = table->find((int)(Z - betaType));
+    if (it != table->end()) {
+      std::copy(it->second.begin(), it->second.end(), exPars);
     }
   } else {
     consoleLogger->error("ERROR: Can't find Exchange parameters file at {}.", exParamFile);
@@ -322,9 +413,10 @@ void bsg::Generator::InitializeL0Constants() {
 
 void bsg::Generator::InitializeNSMInfo() {
   debugFileLogger->debug("Entering InitializeNSMInfo");
-  nsm = new NS::NuclearStructureManager();
+  nsm = new NS::NuclearStructureManager(options.GetNMEOptions(), debugFileLogger);
+  AddOutputFile("nme");
 
-  if (BSGOptExists(connect)) {
+  if (options.Exists("connect")) {
     int dKi, dKf;
     nsm->GetESPStates(spsi, spsf, dKi, dKf);
   }
@@ -335,26 +427,26 @@ void bsg::Generator::InitializeNSMInfo() {
 void bsg::Generator::GetMatrixElements() {
   debugFileLogger->info("Calculating matrix elements");
   double M101 = 1.0;
-  if (!BSGOptExists(Spectrum.Lambda)) {
+  if (!options.Exists("Spectrum.Lambda")) {
     M101 = nsm->CalculateReducedMatrixElement(false, 1, 0, 1);
     double M121 = nsm->CalculateReducedMatrixElement(false, 1, 2, 1);
     ratioM121 = M121 / M101;
   } else {
-    ratioM121 = GetBSGOpt(double, Spectrum.Lambda);
+    ratioM121 = options.Get<double>("Spectrum.Lambda");
   }
 
   bAc = dAc = 0;
-  if (!BSGOptExists(Spectrum.WeakMagnetism)) {
+  if (!options.Exists("Spectrum.WeakMagnetism")) {
     debugFileLogger->info("Calculating Weak Magnetism");
     bAc = nsm->CalculateWeakMagnetism();
   } else {
-    bAc = GetBSGOpt(double, Spectrum.WeakMagnetism);
+    bAc = options.Get<double>("Spectrum.WeakMagnetism");
   }
-  if (!BSGOptExists(Spectrum.InducedTensor)) {
+  if (!options.Exists("Spectrum.InducedTensor")) {
     debugFileLogger->info("Calculating Induced Tensor");
     dAc = nsm->CalculateInducedTensor();
   } else {
-    dAc = GetBSGOpt(double, Spectrum.InducedTensor);
+    dAc = options.Get<double>("Spectrum.InducedTensor");
   }
 
   if (std::isnan(bAc)) {
@@ -388,125 +480,177 @@ void bsg::Generator::GetMatrixElements() {
   fd = dAc * A * fc1;
 }
 
-std::tuple<double, double> bsg::Generator::CalculateDecayRate(double W) {
-  // auto start = std::chrono::steady_clock::now();
-  double result = 1;
-  double neutrinoResult = 1;
-
-  double Wv = W0 - W + 1;
-
-  if (GetBSGOpt(bool, Spectrum.Phasespace)) {
-    result *= SF::PhaseSpace(W, W0, motherSpinParity, daughterSpinParity);
-    neutrinoResult *=
-        SF::PhaseSpace(Wv, W0, motherSpinParity, daughterSpinParity);
-  }
-  // auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
-  // std::cout << "PS microseconds since start: " << elapsed.count() << "\n";
-  if (GetBSGOpt(bool, Spectrum.Fermi)) {
-    result *= SF::FermiFunction(W, Z, R, betaType);
-    neutrinoResult *= SF::FermiFunction(Wv, Z, R, betaType);
-  }
-  // elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
-  // std::cout << "F microseconds since start: " << elapsed.count() << "\n";
-  if (GetBSGOpt(bool, Spectrum.C)) {
-    if (BSGOptExists(connect)) {
-      result *= SF::CCorrection(W, W0, Z, A, R, betaType, decayType, gA,
-                                gP, fc1, fb, fd, ratioM121, GetBSGOpt(bool, Spectrum.Isovector), NSShape, hoFit, spsi, spsf);
-      neutrinoResult *=
-          SF::CCorrection(Wv, W0, Z, A, R, betaType, decayType, gA, gP,
-                          fc1, fb, fd, ratioM121, GetBSGOpt(bool, Spectrum.Isovector), NSShape, hoFit, spsi, spsf);
+void bsg::Generator::InitializeCorrectionPlan() {
+  debugFileLogger->debug("Entering InitializeCorrectionPlan");
+  if (options.Get<bool>("Spectrum.Phasespace")) {
+    auto f = [this](double W) { return SF::PhaseSpace(W, W0, motherSpinParity, daughterSpinParity); };
+    auto fb = [this](const double* W, double* r, int n) { SF::PhaseSpace(W, r, n, W0, motherSpinParity, daughterSpinParity); };
+    plan.AddSymmetric("Phasespace", f, fb);
+  }
+  if (options.Get<bool>("Spectrum.Fermi")) {
+    auto f = [this](double W) { return SF::FermiFunction(W, Z, R, betaType); };
+    auto fb = [this](const double* W, double* r, int n) { SF::FermiFunction(W, r, n, Z, R, betaType); };
+    plan.AddSymmetric("Fermi", f, fb);
+  }
+  if (options.Get<bool>("Spectrum.C")) {
+    bool addCI = options.Get<bool>("Spectrum.Isovector");
+    SF::CCorrectionCoefficients cCoefficients = SF::CalculateCCorrectionCoefficients(
+        W0, Z, A, R, betaType, decayType, gA, gP, fc1, fb, fd, ratioM121, NSShape, hoFit);
+    if (options.Exists("connect")) {
+      auto f = [this, cCoefficients, addCI](double W) {
+        return SF::CCorrection(W, cCoefficients, addCI, spsi, spsf);
+      };
+      auto fb = [this, cCoefficients, addCI](const double* W, double* r, int n) {
+        SF::CCorrection(W, r, n, cCoefficients, addCI, spsi, spsf);
+      };
+      plan.AddSymmetric("C", f, fb);
     } else {
-      result *= SF::CCorrection(W, W0, Z, A, R, betaType, decayType, gA,
-                                gP, fc1, fb, fd, ratioM121, GetBSGOpt(bool, Spectrum.Isovector), NSShape, hoFit);
-      neutrinoResult *=
-          SF::CCorrection(Wv, W0, Z, A, R, betaType, decayType, gA, gP,
-                          fc1, fb, fd, ratioM121, GetBSGOpt(bool, Spectrum.Isovector), NSShape, hoFit);
+      auto f = [cCoefficients, addCI](double W) {
+        return SF::CCorrection(W, cCoefficients, addCI);
+      };
+      auto fb = [cCoefficients, addCI](const double* W, double* r, int n) {
+        SF::CCorrection(W, r, n, cCoefficients, addCI);
+      };
+      plan.AddSymmetric("C", f, fb);
     }
   }
-  // elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
-  // std::cout << "C microseconds since start: " << elapsed.count() << "\n";
-  if (GetBSGOpt(bool, Spectrum.Relativistic)) {
-    result *= SF::RelativisticCorrection(W, W0, Z, A, R, betaType, decayType);
-    neutrinoResult *=
-        SF::RelativisticCorrection(Wv, W0, Z, A, R, betaType, decayType);
-  }
-  // elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
-  // std::cout << "Rel microseconds since start: " << elapsed.count() << "\n";
-  if (GetBSGOpt(bool, Spectrum.ESDeformation)) {
-    result *=
-        SF::DeformationCorrection(W, W0, Z, R, daughterBeta2, betaType, aPos, aNeg);
-    neutrinoResult *=
-        SF::DeformationCorrection(Wv, W0, Z, R, daughterBeta2, betaType, aPos, aNeg);
-  }
-  // elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
-  // std::cout << "ESD microseconds since start: " << elapsed.count() << "\n";
-  if (GetBSGOpt(bool, Spectrum.ESFiniteSize)) {
-    result *= SF::L0Correction(W, Z, R, betaType, aPos, aNeg);
-    neutrinoResult *= SF::L0Correction(Wv, Z, R, betaType, aPos, aNeg);
-  }
-  // elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
-  // std::cout << "ESF microseconds since start: " << elapsed.count() << "\n";
-  if (GetBSGOpt(bool, Spectrum.U)) {
-    result *= SF::UCorrection(W, Z, R, betaType, ESShape, vOld, vNew);
-    neutrinoResult *= SF::UCorrection(Wv, Z, R, betaType, ESShape, vOld, vNew);
-  }
-  // elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
-  // std::cout << "U microseconds since start: " << elapsed.count() << "\n";
-  if (GetBSGOpt(bool, Spectrum.CoulombRecoil)) {
-    result *= SF::QCorrection(W, W0, Z, A, betaType, decayType, mixingRatio);
-    neutrinoResult *=
-        SF::QCorrection(Wv, W0, Z, A, betaType, decayType, mixingRatio);
-  }
-  // elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
-  // std::cout << "CR microseconds since start: " << elapsed.count() << "\n";
-  if (GetBSGOpt(bool, Spectrum.Radiative)) {
-    result *= SF::RadiativeCorrection(W, W0, Z, R, betaType, gA, gM);
-    neutrinoResult *= SF::NeutrinoRadiativeCorrection(Wv);
-  }
-  // elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
-  // std::cout << "Rad microseconds since start: " << elapsed.count() << "\n";
-  if (GetBSGOpt(bool, Spectrum.Recoil)) {
-    result *= SF::RecoilCorrection(W, W0, A, decayType, mixingRatio);
-    neutrinoResult *= SF::RecoilCorrection(Wv, W0, A, decayType, mixingRatio);
-  }
-  // elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
-  // std::cout << "Rec microseconds since start: " << elapsed.count() << "\n";
-  if (GetBSGOpt(bool, Spectrum.Screening)) {
-    result *= SF::AtomicScreeningCorrection(W, Z, betaType);
-    neutrinoResult *= SF::AtomicScreeningCorrection(Wv, Z, betaType);
-  }
-  // elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
-  // std::cout << "S microseconds since start: " << elapsed.count() << "\n";
-  if (GetBSGOpt(bool, Spectrum.Exchange)) {
-    if (betaType == BETA_MINUS) {
-      result *= SF::AtomicExchangeCorrection(W, exPars);
-      neutrinoResult *= SF::AtomicExchangeCorrection(Wv, exPars);
-    }
+  if (options.Get<bool>("Spectrum.Relativistic")) {
+    auto f = [this](double W) { return SF::RelativisticCorrection(W, W0, Z, A, R, betaType, decayType); };
+    plan.AddSymmetric("Relativistic", f, nullptr);
   }
-  // elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
-  // std::cout << "Ex microseconds since start: " << elapsed.count() << "\n";
-  if (GetBSGOpt(bool, Spectrum.AtomicMismatch)) {
-    if (atomicEnergyDeficit == 0.) {
-      result *= SF::AtomicMismatchCorrection(W, W0, Z, A, betaType);
-      neutrinoResult *= SF::AtomicMismatchCorrection(Wv, W0, Z, A, betaType);
+  if (options.Get<bool>("Spectrum.ESDeformation")) {
+    auto f = [this](double W) { return SF::DeformationCorrection(W, W0, Z, R, daughterBeta2, betaType, aPos, aNeg); };
+    double tolerance = options.Get<double>("Spectrum.ESDeformationTolerance");
+    if (tolerance > 0.) {
+      const int maxNodes = 4097;
+      deformationSpline = utilities::AdaptiveMonotoneSpline(f, 1., W0, tolerance, maxNodes, deformationError);
+      debugFileLogger->info("Deformation correction interpolated on {} nodes with relative midpoint error {}",
+                            deformationSpline.Size(), deformationError);
+      if (deformationError > tolerance) {
+        consoleLogger->warn("The deformation correction was interpolated on the maximum of {} nodes with an estimated "
+                            "relative error of {:.2e}, above Spectrum.ESDeformationTolerance = {:.2e}",
+                            maxNodes, deformationError, tolerance);
+      }
+      auto fs = [this, f](double W) { return deformationSpline.Contains(W) ? deformationSpline.GetValue(W) : f(W); };
+      plan.AddSymmetric("ESDeformation", fs, nullptr);
+    } else {
+      plan.AddSymmetric("ESDeformation", f, nullptr);
     }
   }
-  // elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
-  // std::cout << "AM microseconds since start: " << elapsed.count() << "\n";
+  if (options.Get<bool>("Spectrum.ESFiniteSize")) {
+    auto f = [this](double W) { return SF::L0Correction(W, Z, R, betaType, aPos, aNeg); };
+    auto fb = [this](const double* W, double* r, int n) { SF::L0Correction(W, r, n, Z, R, betaType, aPos, aNeg); };
+    plan.AddSymmetric("ESFiniteSize", f, fb);
+  }
+  if (options.Get<bool>("Spectrum.U")) {
+    auto f = [this](double W) { return SF::UCorrection(W, Z, R, betaType, ESShape, vOld, vNew); };
+    auto fb = [this](const double* W, double* r, int n) { SF::UCorrection(W, r, n, Z, R, betaType, ESShape, vOld, vNew); };
+    plan.AddSymmetric("U", f, fb);
+  }
+  if (options.Get<bool>("Spectrum.CoulombRecoil")) {
+    auto f = [this](double W) { return SF::QCorrection(W, W0, Z, A, betaType, decayType, mixingRatio); };
+    auto fb = [this](const double* W, double* r, int n) { SF::QCorrection(W, r, n, W0, Z, A, betaType, decayType, mixingRatio); };
+    plan.AddSymmetric("CoulombRecoil", f, fb);
+  }
+  if (options.Get<bool>("Spectrum.Radiative")) {
+    plan.Add("Radiative",
+             [this](double W) { return SF::RadiativeCorrection(W, W0, Z, R, betaType, gA, gM); },
+             [](double Wv) { return SF::NeutrinoRadiativeCorrection(Wv); },
+             [this](const double* W, double* r, int n) { SF::RadiativeCorrection(W, r, n, W0, Z, R, betaType, gA, gM); },
+             [](const double* Wv, double* r, int n) { SF::NeutrinoRadiativeCorrection(Wv, r, n); });
+  }
+  if (options.Get<bool>("Spectrum.Recoil")) {
+    auto f = [this](double W) { return SF::RecoilCorrection(W, W0, A, decayType, mixingRatio); };
+    auto fb = [this](const double* W, double* r, int n) { SF::RecoilCorrection(W, r, n, W0, A, decayType, mixingRatio); };
+    plan.AddSymmetric("Recoil", f, fb);
+  }
+  if (options.Get<bool>("Spectrum.Screening")) {
+    SF::ScreeningContext screeningContext = SF::CalculateScreeningContext(Z, betaType);
+    auto f = [screeningContext](double W) { return SF::AtomicScreeningCorrection(W, screeningContext); };
+    plan.AddSymmetric("Screening", f, nullptr);
+  }
+  if (options.Get<bool>("Spectrum.Exchange") && betaType == BETA_MINUS) {
+    auto f = [this](double W) { return SF::AtomicExchangeCorrection(W, exPars); };
+    auto fb = [this](const double* W, double* r, int n) { SF::AtomicExchangeCorrection(W, r, n, exPars); };
+    plan.AddSymmetric("Exchange", f, fb);
+  }
+  if (options.Get<bool>("Spectrum.AtomicMismatch") && atomicEnergyDeficit == 0.) {
+    auto f = [this](double W) { return SF::AtomicMismatchCorrection(W, W0, Z, A, betaType); };
+    plan.AddSymmetric("AtomicMismatch", f, nullptr);
+  }
+  debugFileLogger->debug("Correction plan contains {} kernels", plan.GetKernels().size());
+}
+
+std::tuple<double, double> bsg::Generator::CalculateDecayRate(double W) {
+  return EvaluateDecayRate(W);
+}
+
+std::tuple<double, double> bsg::Generator::EvaluateDecayRate(double W) {
+  double Wv = W0 - W + 1;
+
+  double result, neutrinoResult;
+  std::tie(result, neutrinoResult) = plan.Evaluate(W, Wv);
+
   result = std::max(0., result);
   neutrinoResult = std::max(0., neutrinoResult);
-  rawSpectrumLogger->info("{:<10f}\t{:<10f}\t{:<10f}\t{:<10f}", W, (W-1.)*ELECTRON_MASS_KEV, result, neutrinoResult);
-  // elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
-  // std::cout << "File microseconds since start: " << elapsed.count() << "\n";
   return std::make_tuple(result, neutrinoResult);
 }
 
-std::vector<std::vector<double> >* bsg::Generator::CalculateSpectrum() {
-  spectrum = new std::vector<std::vector<double> >();
-  // auto start = std::chrono::steady_clock::now();
-  debugFileLogger->info("Calculating spectrum");
-  double beginEn = GetBSGOpt(double, Spectrum.Begin);
-  double endEn = GetBSGOpt(double, Spectrum.End);
+void bsg::Generator::EvaluateDecayRates(const double W[], double electron[],
+                                        double neutrino[], int size, double seconds[]) {
+  std::vector<double> Wv(size);
+  for (int i = 0; i < size; i++) {
+    Wv[i] = W0 - W[i] + 1;
+  }
+
+  plan.EvaluateBatch(W, Wv.data(), electron, neutrino, size, seconds);
+
+  for (int i = 0; i < size; i++) {
+    electron[i] = std::max(0., electron[i]);
+    neutrino[i] = std::max(0., neutrino[i]);
+  }
+}
+
+bool bsg::Generator::UseSymmetricGrid() {
+  if (!options.Get<bool>("Spectrum.SymmetricGrid")) {
+    return false;
+  }
+  if (options.Exists("Spectrum.EnergyList")) {
+    consoleLogger->warn("Spectrum.SymmetricGrid cannot be used with Spectrum.EnergyList. Using the given energies.");
+    return false;
+  }
+  if (options.Get<double>("Spectrum.End") != 0.0) {
+    consoleLogger->warn("Spectrum.SymmetricGrid requires Spectrum.End to be 0. Using the regular grid.");
+    return false;
+  }
+  return true;
+}
+
+bsg::EnergyGrid bsg::Generator::GetEnergyGrid(bool symmetric) {
+  if (options.Exists("Spectrum.EnergyList")) {
+    std::vector<double> energies;
+    if (!utilities::ReadValues(options.Get<std::string>("Spectrum.EnergyList"), energies)) {
+      consoleLogger->error("Cannot read energies from {}", options.Get<std::string>("Spectrum.EnergyList"));
+    }
+    std::sort(energies.begin(), energies.end());
+    for (auto& E : energies) {
+      E = E / ELECTRON_MASS_KEV + 1.;
+    }
+    // like parts of bins in CalculateBinIntegrals, energies outside of the spectrum do not
+    // contribute, instead of giving a rate through (W0 - W)^2 above it or NaN below it
+    std::size_t nGiven = energies.size();
+    energies.erase(std::remove_if(energies.begin(), energies.end(), [this](double W) { return !(W >= 1. && W <= W0); }),
+                   energies.end());
+    if (energies.size() < nGiven) {
+      consoleLogger->warn("Skipping {} of the energies in {} that lie outside of [0, {}] keV", nGiven - energies.size(),
+                          options.Get<std::string>("Spectrum.EnergyList"), (W0 - 1.) * ELECTRON_MASS_KEV);
+    }
+    debugFileLogger->debug("Using {} given energies", energies.size());
+    return EnergyGrid(energies);
+  }
+
+  double beginEn = options.Get<double>("Spectrum.Begin");
+  double endEn = options.Get<double>("Spectrum.End");
 
   double beginW = beginEn / ELECTRON_MASS_KEV + 1.;
   double endW = endEn / ELECTRON_MASS_KEV + 1.;
@@ -514,29 +658,478 @@ std::vector<std::vector<double> >* bsg::Generator::CalculateSpectrum() {
     endW = W0;
   }
 
-  double stepW = GetBSGOpt(double, Spectrum.StepSize) / ELECTRON_MASS_KEV;
-  if (BSGOptExists(Spectrum.Steps)) {
-    stepW = (endW-beginW)/GetBSGOpt(int, Spectrum.Steps);
+  double stepW = options.Get<double>("Spectrum.StepSize") / ELECTRON_MASS_KEV;
+
+  if (symmetric) {
+    // W_k + W_{M-k} = W0 + 1, so that the neutrino energy at every node is again a node
+    endW = W0 + 1. - beginW;
+    if (beginW > 1.) {
+      consoleLogger->warn("Spectrum.SymmetricGrid with Spectrum.Begin = {} keV ends the spectrum at {} keV instead of the endpoint {} keV",
+                          options.Get<double>("Spectrum.Begin"), (endW - 1.) * ELECTRON_MASS_KEV, (W0 - 1.) * ELECTRON_MASS_KEV);
+    }
+    int M = options.Exists("Spectrum.Steps") ? options.Get<int>("Spectrum.Steps")
+                                          : (int)std::round((endW - beginW) / stepW);
+    M = std::max(1, M);
+    debugFileLogger->debug("Using symmetric grid with {} nodes", M + 1);
+    return EnergyGrid(beginW, endW, M);
+  }
+
+  if (options.Exists("Spectrum.Steps")) {
+    stepW = (endW-beginW)/options.Get<int>("Spectrum.Steps");
+  }
+
+  return EnergyGrid(beginW, endW, stepW);
+}
+
+void bsg::Generator::ForEachChunk(std::size_t size, int nThreads,
+                                  const std::function<void(std::size_t, std::size_t, double*)>& f) {
+  std::size_t nChunks = (size + GRID_CHUNK_SIZE - 1) / GRID_CHUNK_SIZE;
+  std::atomic<std::size_t> nextChunk(0);
+  std::exception_ptr error = nullptr;
+  std::mutex errorMutex;
+
+  auto worker = [&]() {
+    // timings are kept per thread and added to correctionTimes at the end
+    std::vector<double> seconds(plan.GetKernels().size(), 0.);
+    try {
+      std::size_t chunk;
+      while ((chunk = nextChunk++) < nChunks) {
+        if (cancelFlag && *cancelFlag) throw CalculationCancelled();
+        std::size_t begin = chunk * GRID_CHUNK_SIZE;
+        f(begin, std::min(size, begin + GRID_CHUNK_SIZE), seconds.data());
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(errorMutex);
+      if (!error) error = std::current_exception();
+      nextChunk = nChunks;
+    }
+    std::lock_guard<std::mutex> lock(errorMutex);
+    for (std::size_t k = 0; k < seconds.size(); k++) correctionTimes[k] += seconds[k];
+  };
+
+  nThreads = std::max(1, std::min(nThreads, (int)nChunks));
+  if (nThreads == 1) {
+    worker();
+  } else {
+    debugFileLogger->debug("Evaluating {} grid points on {} threads", size, nThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; t++) {
+      threads.push_back(std::thread(worker));
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+  if (error) std::rethrow_exception(error);
+}
+
+void bsg::Generator::EvaluateEnergyGrid(const std::vector<double>& grid,
+                                        std::vector<double>& electron,
+                                        std::vector<double>& neutrino,
+                                        int nThreads, bool symmetric) {
+  electron.resize(grid.size());
+  neutrino.resize(grid.size());
+
+  // product of the corrections shared by electron and neutrino, only used for a symmetric grid
+  std::vector<double> shared;
+  std::vector<double> reversed;
+  if (symmetric) {
+    shared.assign(grid.size(), 1.);
+    reversed.assign(grid.rbegin(), grid.rend());
+  }
+
+  ForEachChunk(grid.size(), nThreads, [&](std::size_t begin, std::size_t end, double* seconds) {
+    if (symmetric) {
+      std::fill(&electron[begin], &electron[0] + end, 1.);
+      std::fill(&neutrino[begin], &neutrino[0] + end, 1.);
+      plan.Multiply(&grid[begin], &shared[begin], end - begin, false, CorrectionPlan::SYMMETRIC, seconds);
+      plan.Multiply(&grid[begin], &electron[begin], end - begin, false, CorrectionPlan::ASYMMETRIC, seconds);
+      plan.Multiply(&reversed[begin], &neutrino[begin], end - begin, true, CorrectionPlan::ASYMMETRIC, seconds);
+    } else {
+      EvaluateDecayRates(&grid[begin], &electron[begin], &neutrino[begin], end - begin, seconds);
+    }
+  });
+
+  if (symmetric) {
+    std::size_t n = grid.size();
+    for (std::size_t i = 0; i < n; i++) {
+      electron[i] = std::max(0., electron[i] * shared[i]);
+      neutrino[i] = std::max(0., neutrino[i] * shared[n - 1 - i]);
+    }
+  }
+}
+
+void bsg::Generator::EvaluateBreakdown(const std::vector<double>& grid, int nThreads,
+                                       bool symmetric) {
+  const std::vector<CorrectionKernel>& kernels = plan.GetKernels();
+  std::size_t n = grid.size();
+  std::vector<double> Wv(n);
+  for (std::size_t i = 0; i < n; i++) {
+    Wv[i] = W0 - grid[i] + 1;
+  }
+
+  std::vector<std::vector<double>*> electronColumns, neutrinoColumns;
+  for (const auto& k : kernels) {
+    electronColumns.push_back(&spectrum.AddColumn(Spectrum::ElectronColumn(k.name)));
+    neutrinoColumns.push_back(&spectrum.AddColumn(Spectrum::NeutrinoColumn(k.name)));
+  }
+
+  ForEachChunk(n, nThreads, [&](std::size_t begin, std::size_t end, double* seconds) {
+    for (std::size_t k = 0; k < kernels.size(); k++) {
+      plan.EvaluateKernel(k, &grid[begin], &(*electronColumns[k])[begin], end - begin, false, seconds);
+      // on a symmetric grid the neutrino factor of a symmetric correction is the electron factor in reverse
+      if (!(symmetric && kernels[k].symmetric)) {
+        plan.EvaluateKernel(k, &Wv[begin], &(*neutrinoColumns[k])[begin], end - begin, true, seconds);
+      }
+    }
+  });
+
+  for (std::size_t k = 0; k < kernels.size(); k++) {
+    if (symmetric && kernels[k].symmetric) {
+      std::vector<double>& e = *electronColumns[k];
+      std::vector<double>& v = *neutrinoColumns[k];
+      for (std::size_t i = 0; i < n; i++) v[i] = e[n - 1 - i];
+    }
+  }
+
+  std::vector<std::string> names;
+  for (const auto& k : kernels) names.push_back(k.name);
+  spectrum.Recompose(names, spectrum.GetElectron(), spectrum.GetNeutrino());
+}
+
+bsg::Spectrum bsg::Generator::Recompose(const std::set<std::string>& disabled) const {
+  if (!options.Exists("breakdown") || streaming || spectrum.Size() == 0) {
+    throw std::invalid_argument("Recomposing the spectrum requires a spectrum calculated in memory with --breakdown");
+  }
+  std::vector<std::string> names;
+  for (const auto& k : plan.GetKernels()) {
+    if (!disabled.count(k.name)) names.push_back(k.name);
+  }
+  Spectrum result;
+  result.GetW() = spectrum.GetW();
+  spectrum.Recompose(names, result.GetElectron(), result.GetNeutrino());
+  return result;
+}
+
+void bsg::Generator::CalculateBinIntegrals(const std::vector<double>& edges, int order,
+                                           std::vector<double>& electron,
+                                           std::vector<double>& neutrino, int nThreads) {
+  std::size_t nBins = edges.size() > 1 ? edges.size() - 1 : 0;
+  electron.assign(nBins, 0.);
+  neutrino.assign(nBins, 0.);
+
+  std::vector<double> x, w;
+  utilities::GaussLegendre(order, x, w);
+
+  // The electron rate behaves as sqrt(W - 1) at the lower end of the spectrum and the
+  // neutrino rate as sqrt(W0 - W) at the upper end. With W = 1 + (W0 - 1) sin^2(t) both
+  // are smooth in t, so that the quadrature converges quickly also in the outer bins.
+  // Parts of bins outside of [1, W0] do not contribute.
+  auto angle = [this](double E) {
+    double u = std::min(1., std::max(0., E / ELECTRON_MASS_KEV / (W0 - 1.)));
+    return std::asin(std::sqrt(u));
+  };
+  std::vector<double> nodes, nodeWeights;
+  for (std::size_t b = 0; b < nBins; b++) {
+    double lower = angle(edges[b]);
+    double upper = angle(edges[b + 1]);
+    double halfWidth = (upper - lower) / 2.;
+    for (int j = 0; j < order; j++) {
+      double t = (lower + upper) / 2. + halfWidth * x[j];
+      nodes.push_back(1. + (W0 - 1.) * std::pow(std::sin(t), 2.));
+      nodeWeights.push_back(halfWidth * w[j] * (W0 - 1.) * std::sin(2. * t));
+    }
+  }
+
+  std::vector<double> electronNodes, neutrinoNodes;
+  EvaluateEnergyGrid(nodes, electronNodes, neutrinoNodes, nThreads, false);
+
+  for (std::size_t b = 0; b < nBins; b++) {
+    for (int j = 0; j < order; j++) {
+      std::size_t i = b * order + j;
+      electron[b] += nodeWeights[i] * electronNodes[i];
+      neutrino[b] += nodeWeights[i] * neutrinoNodes[i];
+    }
+  }
+}
+
+void bsg::Generator::WriteBinIntegrals(int nThreads) {
+  std::vector<double> edges;
+  std::string fileName = options.Get<std::string>("Spectrum.BinEdges");
+  if (!utilities::ReadValues(fileName, edges) || edges.size() < 2) {
+    consoleLogger->error("Cannot read bin edges from {}", fileName);
+    return;
+  }
+  if (!std::is_sorted(edges.begin(), edges.end())) {
+    consoleLogger->error("Bin edges in {} are not in ascending order", fileName);
+    return;
+  }
+  int order = std::max(1, options.Get<int>("Spectrum.BinOrder"));
+  std::vector<double> electron, neutrino;
+  CalculateBinIntegrals(edges, order, electron, neutrino, nThreads);
+
+  std::ofstream file(outputName + ".bins");
+  if (!file.is_open()) {
+    consoleLogger->error("Cannot write {}.bins", outputName);
+    return;
+  }
+  AddOutputFile("bins");
+  fmt::memory_buffer text;
+  fmt::format_to(std::back_inserter(text), "# E_low [keV]\tE_high [keV]\tN_e\tN_v\n");
+  for (std::size_t b = 0; b < electron.size(); b++) {
+    fmt::format_to(std::back_inserter(text), "{:.10e}\t{:.10e}\t{:.10e}\t{:.10e}\n", edges[b], edges[b + 1], electron[b], neutrino[b]);
+  }
+  file.write(text.data(), text.size());
+}
+
+void bsg::Generator::WriteBreakdown() {
+  std::ofstream file(outputName + ".breakdown");
+  if (!file.is_open()) {
+    consoleLogger->error("Cannot write {}.breakdown", outputName);
+    return;
+  }
+  AddOutputFile("breakdown");
+  const std::vector<CorrectionKernel>& kernels = plan.GetKernels();
+  std::vector<const std::vector<double>*> columns;
+  fmt::memory_buffer text;
+  fmt::format_to(std::back_inserter(text), "# W [m_ec2]");
+  for (const auto& k : kernels) {
+    columns.push_back(&spectrum.GetColumn(Spectrum::ElectronColumn(k.name)));
+    fmt::format_to(std::back_inserter(text), "\t{}", Spectrum::ElectronColumn(k.name));
+  }
+  for (const auto& k : kernels) {
+    columns.push_back(&spectrum.GetColumn(Spectrum::NeutrinoColumn(k.name)));
+    fmt::format_to(std::back_inserter(text), "\t{}", Spectrum::NeutrinoColumn(k.name));
+  }
+  fmt::format_to(std::back_inserter(text), "\n");
+  const std::vector<double>& W = spectrum.GetW();
+  for (std::size_t i = 0; i < spectrum.Size(); i++) {
+    fmt::format_to(std::back_inserter(text), "{:.10e}", W[i]);
+    for (auto c : columns) {
+      fmt::format_to(std::back_inserter(text), "\t{:.10e}", (*c)[i]);
+    }
+    fmt::format_to(std::back_inserter(text), "\n");
+  }
+  file.write(text.data(), text.size());
+}
+
+void bsg::Generator::ResumeCheckpoint(Checkpoint& checkpoint, EnergyGrid& grid,
+                                      const std::vector<SpectrumSink*>& sinks) {
+  std::uint64_t optionsHash = options.GetOptionsHash();
+  std::size_t nTotal = grid.Count();
+  std::string fileName = outputName + ".ckpt";
+
+  Spectrum prefix;
+  SpectrumMoments::State state;
+  if (!options.Exists("resume") || !std::ifstream(fileName)) {
+    if (options.Exists("resume")) {
+      debugFileLogger->info("No checkpoint {} found. Starting from the beginning.", fileName);
+    }
+  } else if (!checkpoint.Resume(optionsHash, nTotal, prefix, state)) {
+    consoleLogger->error("Cannot resume: {}. Starting from the beginning.", checkpoint.GetError());
+  } else {
+    // the energies are generated again rather than trusted, which also
+    // catches a changed energy list that is not part of the options hash
+    EnergyGrid start = grid;
+    std::vector<double> W;
+    grid.Next(W, prefix.Size());
+    if (W != prefix.GetW()) {
+      consoleLogger->error("Cannot resume: the energies in {} do not match the grid. Starting from the beginning.", fileName);
+      grid = start;
+    } else {
+      debugFileLogger->info("Resuming from {} after {} of {} points", fileName, prefix.Size(), nTotal);
+      // the integrals are restored as they were, the other sinks receive the points again
+      moments.SetState(state);
+      for (std::size_t i = 0; i < prefix.Size(); i++) {
+        for (auto sink : sinks) {
+          if (sink != &moments) sink->Push(prefix.GetW()[i], prefix.GetElectron()[i], prefix.GetNeutrino()[i]);
+        }
+      }
+      nPoints = prefix.Size();
+      if (!streaming) {
+        std::swap(spectrum, prefix);
+      }
+      return;
+    }
+  }
+  if (options.Get<double>("checkpoint") > 0. && !checkpoint.Create(optionsHash, nTotal)) {
+    consoleLogger->error("{}. No checkpoints are written.", checkpoint.GetError());
+  }
+}
+
+const bsg::Spectrum& bsg::Generator::CalculateSpectrum() {
+  spectrum.Clear();
+  moments.Reset();
+  nPoints = 0;
+  outputError.clear();
+  correctionTimes.assign(plan.GetKernels().size(), 0.);
+  // keep only the timings of the constructor from a previous call
+  phaseTimes.erase(std::remove_if(phaseTimes.begin(), phaseTimes.end(),
+                                  [](const std::pair<std::string, double>& p) {
+                                    return p.first == "spectrum" || p.first == "output";
+                                  }),
+                   phaseTimes.end());
+  auto start = std::chrono::steady_clock::now();
+  debugFileLogger->info("Calculating spectrum");
+
+  int nThreads = options.Get<int>("threads");
+  if (nThreads <= 0) {
+    nThreads = std::max(1, (int)std::thread::hardware_concurrency());
+  }
+
+  // the spectrum is written to stdout block by block while it is calculated
+  bool toStdout = options.Exists("stdout");
+  streaming = options.Exists("stream") || toStdout;
+  bool symmetric = UseSymmetricGrid();
+  if (symmetric && streaming) {
+    debugFileLogger->info("Corrections are not shared between electron and neutrino when streaming");
+  }
+  EnergyGrid grid = GetEnergyGrid(symmetric);
+  gridKind = grid.IsList() ? "list" : symmetric ? "symmetric" : "regular";
+  gridFirstW = grid.GetFirst();
+  gridLastW = grid.GetLast();
+  gridStepW = grid.GetStep();
+
+  std::string format = options.Get<std::string>("format");
+  if (format != "text" && format != "binary" && format != "root") {
+    consoleLogger->error("Unknown output format \"{}\". Using text.", format);
+    format = "text";
+  }
+  std::unique_ptr<SpectrumSink> writer;
+  RootSpectrumWriter* rootWriter = nullptr;
+  if (toStdout && format == "root") {
+    consoleLogger->warn("The ROOT format cannot be written to standard output. Writing to {}", options.Get<std::string>("rootfile"));
+  }
+  if (toStdout && format != "root") {
+    writer.reset(new StreamSpectrumWriter(stdout, format == "binary", GetFileHeader(grid.Count())));
+  } else if (format == "root") {
+    rootWriter = new RootSpectrumWriter(options.Get<std::string>("rootfile"));
+    writer.reset(rootWriter);
+  } else if (format == "binary") {
+    writer.reset(new BinarySpectrumWriter(outputName + ".bin", GetFileHeader(grid.Count())));
+    AddOutputFile("bin");
+  } else {
+    writer.reset(new TextSpectrumWriter(outputName + ".raw", true, true));
+    AddOutputFile("raw");
+  }
+
+  std::vector<SpectrumSink*> sinks = {&moments, writer.get()};
+
+  bool breakdown = options.Exists("breakdown");
+  if (breakdown && streaming) {
+    consoleLogger->warn("The correction breakdown needs the spectrum in memory and is not calculated when streaming");
+    breakdown = false;
+  }
+  double checkpointInterval = options.Get<double>("checkpoint");
+  bool checkpointing = checkpointInterval > 0. || options.Exists("resume");
+  if (checkpointing && breakdown) {
+    consoleLogger->warn("The correction breakdown is calculated in a single block, so no checkpoints are written");
+    checkpointing = false;
+  }
+  Checkpoint checkpoint(outputName + ".ckpt");
+  if (checkpointing) {
+    ResumeCheckpoint(checkpoint, grid, sinks);
   }
+  auto lastCheckpoint = std::chrono::steady_clock::now();
 
-  double currentW = beginW;
-  while (currentW <= endW) {
-    auto result = CalculateDecayRate(currentW);
-    std::vector<double> entry = {currentW, std::get<0>(result), std::get<1>(result)};
-    spectrum->push_back(entry);
-    currentW += stepW;
+  // without streaming or checkpoints the whole grid is a single block
+  bool blocks = streaming || checkpointing;
+  std::size_t blockSize = blocks ? STREAM_BLOCK_SIZE : std::numeric_limits<std::size_t>::max();
+  if (symmetric && checkpointing && !streaming) {
+    debugFileLogger->info("Corrections are not shared between electron and neutrino when writing checkpoints");
+  }
+  std::vector<double> W, electron, neutrino;
+  while (grid.Next(W, blockSize) > 0) {
+    if (breakdown) {
+      // a single block, which is moved into spectrum before its columns are filled
+      spectrum.GetW().swap(W);
+      spectrum.Resize(spectrum.GetW().size());
+      EvaluateBreakdown(spectrum.GetW(), nThreads, symmetric);
+      // hand the results back, they are swapped into spectrum again below
+      spectrum.GetW().swap(W);
+      spectrum.GetElectron().swap(electron);
+      spectrum.GetNeutrino().swap(neutrino);
+    } else {
+      EvaluateEnergyGrid(W, electron, neutrino, nThreads, symmetric && !blocks);
+    }
+
+    nPoints += W.size();
+    for (std::size_t i = 0; i < W.size(); i++) {
+      for (auto sink : sinks) {
+        sink->Push(W[i], electron[i], neutrino[i]);
+      }
+    }
+    if (checkpoint.IsOpen()) {
+      bool written = checkpoint.Append(&W[0], &electron[0], &neutrino[0], W.size());
+      if (written && SecondsSince(lastCheckpoint) >= checkpointInterval && checkpointInterval > 0.) {
+        written = checkpoint.Commit(moments.GetState());
+        lastCheckpoint = std::chrono::steady_clock::now();
+        debugFileLogger->debug("Checkpoint written after {} points", nPoints);
+      }
+      if (!written) {
+        consoleLogger->error("{}. No further checkpoints are written.", checkpoint.GetError());
+        checkpoint.Remove();
+      }
+    }
+    if (!streaming && spectrum.Size() == 0) {
+      spectrum.GetW().swap(W);
+      spectrum.GetElectron().swap(electron);
+      spectrum.GetNeutrino().swap(neutrino);
+    } else if (!streaming) {
+      spectrum.GetW().insert(spectrum.GetW().end(), W.begin(), W.end());
+      spectrum.GetElectron().insert(spectrum.GetElectron().end(), electron.begin(), electron.end());
+      spectrum.GetNeutrino().insert(spectrum.GetNeutrino().end(), neutrino.begin(), neutrino.end());
+    }
+    W.clear();
+  }
+  // the spectrum is complete, so a restart would have nothing to continue
+  if (checkpoint.IsOpen()) {
+    checkpoint.Remove();
+  }
+  if (rootWriter) {
+    SpectrumSummary summary;
+    summary.name = outputName;
+    summary.options = options.GetOptionsString();
+    summary.optionsHash = options.GetOptionsHash();
+    summary.Z = Z;
+    summary.A = A;
+    summary.W0 = W0;
+    summary.QValue = QValue;
+    summary.betaType = betaType;
+    summary.f = moments.GetMoment(0);
+    // without a halflife there is no log ft, and log f would be indistinguishable from it
+    summary.logFt = options.Exists("Transition.PartialHalflife")
+                        ? CalculateLogFtValue(options.Get<double>("Transition.PartialHalflife"))
+                        : std::numeric_limits<double>::quiet_NaN();
+    summary.meanEnergy = (CalculateMeanEnergy()-1.)*ELECTRON_MASS_KEV;
+    summary.bAc = bAc;
+    summary.dAc = dAc;
+    summary.lambda = ratioM121;
+    rootWriter->WriteSummary(summary);
+  }
+  // waits until everything is on disk
+  if (!writer->Close()) {
+    outputError = writer->GetError();
+    consoleLogger->error("{}", outputError);
   }
-  // auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
-  // std::cout << "microseconds since CalculateSpectrum: " << elapsed.count() << "\n";
+  writer.reset();
+  phaseTimes.push_back(std::make_pair("spectrum", SecondsSince(start)));
+  start = std::chrono::steady_clock::now();
   PrepareOutputFile();
-  // elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
-  // std::cout << "microseconds since CalculateSpectrum: " << elapsed.count() << "\n";
+  if (breakdown) {
+    WriteBreakdown();
+  }
+  if (options.Exists("Spectrum.BinEdges")) {
+    WriteBinIntegrals(nThreads);
+  }
+  phaseTimes.push_back(std::make_pair("output", SecondsSince(start)));
+  WriteJsonSummary();
   return spectrum;
 }
 
 double bsg::Generator::CalculateLogFtValue(double partialHalflife) {
   debugFileLogger->debug("Calculating Ft value with partial halflife {}", partialHalflife);
-  double f = utilities::Simpson(*spectrum);
+  double f = moments.GetMoment(0);
   debugFileLogger->debug("f: {}", f);
   double ft = f*partialHalflife;
   double logFt = std::log10(ft);
@@ -546,97 +1139,227 @@ double bsg::Generator::CalculateLogFtValue(double partialHalflife) {
 
 double bsg::Generator::CalculateMeanEnergy() {
   debugFileLogger->debug("Calculating mean energy");
-  std::vector<std::vector<double> > weightedSpectrum;
-  for (int i =0; i < spectrum->size(); i++) {
-    std::vector<double> entry = {(*spectrum)[i][0], (*spectrum)[i][0]* (*spectrum)[i][1]};
-    weightedSpectrum.push_back(entry);
-  }
-  double weightedF = utilities::Simpson(weightedSpectrum);
-  double f = utilities::Simpson(*spectrum);
+  double weightedF = moments.GetMoment(1);
+  double f = moments.GetMoment(0);
   debugFileLogger->debug("Weighted f: {} Clean f: {}", weightedF, f);
   return weightedF/f;
 }
 
 void bsg::Generator::PrepareOutputFile() {
-  ShowBSGInfo();
+  ShowBSGInfo(resultsFileLogger);
 
-  auto l = spdlog::get("BSG_results_file");
+  auto l = resultsFileLogger;
   l->info("Spectrum input overview\n{:=>30}", "");
-  //l->info("Using information from {}\n\n", GetBSGOpt(std::string, input));
+  //l->info("Using information from {}\n\n", options.Get<std::string>("input"));
   l->info("Transition from {}{} [{}/2] ({} keV) to {}{} [{}/2] ({} keV)", A, utilities::atoms[int(Z-1-betaType)], motherSpinParity, motherExcitationEn, A, utilities::atoms[int(Z-1)], daughterSpinParity, daughterExcitationEn);
   l->info("Q Value: {} keV\tEffective endpoint energy: {}", QValue, (W0-1.)*ELECTRON_MASS_KEV);
-  l->info("Process: {}\tType: {}", GetBSGOpt(std::string, Transition.Process), GetBSGOpt(std::string, Transition.Type));
+  l->info("Process: {}\tType: {}", options.Get<std::string>("Transition.Process"), options.Get<std::string>("Transition.Type"));
   if (mixingRatio != 0) l->info("Mixing ratio: {}", mixingRatio);
 
   // double BGT = fc1*fc1/(std::abs(motherSpinParity)+1)
   // double kappa = 6147.; // The combination of constants for the ft value in s
   // double ftTheory = std::log10(kappa/BGT);
   // l->info("");
-  if (BSGOptExists(Transition.PartialHalflife)) {
-    l->info("Partial halflife: {} s", GetBSGOpt(double, Transition.PartialHalflife));
-    l->info("Calculated log ft value: {}", CalculateLogFtValue(GetBSGOpt(double, Transition.PartialHalflife)));
+  if (options.Exists("Transition.PartialHalflife")) {
+    l->info("Partial halflife: {} s", options.Get<double>("Transition.PartialHalflife"));
+    l->info("Calculated log ft value: {}", CalculateLogFtValue(options.Get<double>("Transition.PartialHalflife")));
   } else {
     l->info("Partial halflife: not given");
     l->info("Calculated log f value: {}", CalculateLogFtValue(1.0));
   }
-  if (BSGOptExists(Transition.LogFt)) {
-    l->info("External Log ft: {:.3f}", GetBSGOpt(double, Transition.LogFt));
-    if (BSGOptExists(Transition.PartialHalflife)) {
+  if (options.Exists("Transition.LogFt")) {
+    l->info("External Log ft: {:.3f}", options.Get<double>("Transition.LogFt"));
+    if (options.Exists("Transition.PartialHalflife")) {
       l->info("Ratio of calculated/external ft value: {}", std::pow(10.,
-        CalculateLogFtValue(GetBSGOpt(double, Transition.PartialHalflife))
-         - GetBSGOpt(double, Transition.LogFt)));
+        CalculateLogFtValue(options.Get<double>("Transition.PartialHalflife"))
+         - options.Get<double>("Transition.LogFt")));
     }
   }
   l->info("Mean energy: {} keV", (CalculateMeanEnergy()-1.)*ELECTRON_MASS_KEV);
   l->info("\nMatrix Element Summary\n{:->30}", "");
-  if (BSGOptExists(Spectrum.WeakMagnetism)) l->info("{:35}: {} ({})", "b/Ac (weak magnetism)", bAc, "given");
+  if (options.Exists("Spectrum.WeakMagnetism")) l->info("{:35}: {} ({})", "b/Ac (weak magnetism)", bAc, "given");
   else l->info("{:35}: {}", "b/Ac (weak magnetism)", bAc);
-  if (BSGOptExists(Spectrum.Inducedtensor)) l->info("{:35}: {} ({})", "d/Ac (induced tensor)", dAc, "given");
+  if (options.Exists("Spectrum.Inducedtensor")) l->info("{:35}: {} ({})", "d/Ac (induced tensor)", dAc, "given");
   else l->info("{:35}: {}", "d/Ac (induced tensor)", dAc);
-  if (BSGOptExists(Spectrum.Lambda)) l->info("{:35}: {} ({})", "AM121/AM101", ratioM121, "given");
+  if (options.Exists("Spectrum.Lambda")) l->info("{:35}: {} ({})", "AM121/AM101", ratioM121, "given");
   else l->info("{:35}: {}", "AM121/AM101", ratioM121);
 
   l->info("Full breakdown written in {}.nme", outputName);
 
   l->info("\nSpectral corrections\n{:->30}", "");
-  l->info("{:25}: {}", "Phase space", GetBSGOpt(bool, Spectrum.Phasespace));
-  l->info("{:25}: {}", "Fermi function", GetBSGOpt(bool, Spectrum.Fermi));
-  l->info("{:25}: {}", "L0 correction", GetBSGOpt(bool, Spectrum.ESFiniteSize));
-  l->info("{:25}: {}", "C correction", GetBSGOpt(bool, Spectrum.C));
-  l->info("    NS Shape: {}", GetBSGOpt(std::string, Spectrum.NSShape));
-  l->info("{:25}: {}", "Isovector correction", GetBSGOpt(bool, Spectrum.Isovector));
-  l->info("    Connected: {}", GetBSGOpt(bool, Spectrum.Connect));
-  l->info("{:25}: {}", "Relativistic terms", GetBSGOpt(bool, Spectrum.Relativistic));
-  l->info("{:25}: {}", "Deformation", GetBSGOpt(bool, Spectrum.ESDeformation));
-  l->info("{:25}: {}", "U correction", GetBSGOpt(bool, Spectrum.U));
-  l->info("    ES Shape: {}", GetBSGOpt(std::string, Spectrum.ESShape));
-  if (BSGOptExists(Spectrum.vold) && BSGOptExists(Spectrum.vnew)) {
+  l->info("{:25}: {}", "Phase space", options.Get<bool>("Spectrum.Phasespace"));
+  l->info("{:25}: {}", "Fermi function", options.Get<bool>("Spectrum.Fermi"));
+  l->info("{:25}: {}", "L0 correction", options.Get<bool>("Spectrum.ESFiniteSize"));
+  l->info("{:25}: {}", "C correction", options.Get<bool>("Spectrum.C"));
+  l->info("    NS Shape: {}", options.Get<std::string>("Spectrum.NSShape"));
+  l->info("{:25}: {}", "Isovector correction", options.Get<bool>("Spectrum.Isovector"));
+  l->info("    Connected: {}", options.Get<bool>("Spectrum.Connect"));
+  l->info("{:25}: {}", "Relativistic terms", options.Get<bool>("Spectrum.Relativistic"));
+  l->info("{:25}: {}", "Deformation", options.Get<bool>("Spectrum.ESDeformation"));
+  if (deformationSpline.Size() > 0) {
+    l->info("    Interpolated on {} nodes, estimated relative error {:.2e} (largest at the interval midpoints, not a bound)",
+            deformationSpline.Size(), deformationError);
+  }
+  l->info("{:25}: {}", "U correction", options.Get<bool>("Spectrum.U"));
+  l->info("    ES Shape: {}", options.Get<std::string>("Spectrum.ESShape"));
+  if (options.Exists("Spectrum.vold") && options.Exists("Spectrum.vnew")) {
     l->info("    v : {}, {}, {}", vOld[0], vOld[1], vOld[2]);
     l->info("    v': {}, {}, {}", vNew[0], vNew[1], vNew[2]);
   } else {
     l->info("    v : not given");
     l->info("    v': not given");
   }
-  l->info("{:25}: {}", "Q correction", GetBSGOpt(bool, Spectrum.CoulombRecoil));
-  l->info("{:25}: {}", "Radiative correction", GetBSGOpt(bool, Spectrum.Radiative));
-  l->info("{:25}: {}", "Nuclear recoil", GetBSGOpt(bool, Spectrum.Recoil));
-  l->info("{:25}: {}", "Atomic screening", GetBSGOpt(bool, Spectrum.Screening));
-  l->info("{:25}: {}", "Atomic exchange", GetBSGOpt(bool, Spectrum.Exchange));
-  l->info("{:25}: {}", "Atomic mismatch", GetBSGOpt(bool, Spectrum.AtomicMismatch));
-  l->info("{:25}: {}", "Export neutrino", GetBSGOpt(bool, Spectrum.Neutrino));
-
-  l->info("\n\nSpectrum calculated from {} keV to {} keV with step size {} keV\n",
-  GetBSGOpt(double, Spectrum.Begin),
-  GetBSGOpt(double, Spectrum.End) > 0 ? GetBSGOpt(double, Spectrum.End) : (W0-1.)*ELECTRON_MASS_KEV, GetBSGOpt(double, Spectrum.StepSize));
+  l->info("{:25}: {}", "Q correction", options.Get<bool>("Spectrum.CoulombRecoil"));
+  l->info("{:25}: {}", "Radiative correction", options.Get<bool>("Spectrum.Radiative"));
+  l->info("{:25}: {}", "Nuclear recoil", options.Get<bool>("Spectrum.Recoil"));
+  l->info("{:25}: {}", "Atomic screening", options.Get<bool>("Spectrum.Screening"));
+  l->info("{:25}: {}", "Atomic exchange", options.Get<bool>("Spectrum.Exchange"));
+  l->info("{:25}: {}", "Atomic mismatch", options.Get<bool>("Spectrum.AtomicMismatch"));
+  l->info("{:25}: {}", "Export neutrino", options.Get<bool>("Spectrum.Neutrino"));
 
-  if (GetBSGOpt(bool, Spectrum.Neutrino))  l->info("{:10}\t{:10}\t{:10}\t{:10}", "W [m_ec2]", "E [keV]", "dN_e/dW", "dN_v/dW");
-  else l->info("{:10}\t{:10}\t{:10}", "W [m_ec2]", "E [keV]", "dN_e/dW");
+  if (gridKind == "list") {
+    l->info("\n\nSpectrum calculated at {} energies from {}, from {} keV to {} keV\n", nPoints,
+            options.Get<std::string>("Spectrum.EnergyList"), (gridFirstW-1.)*ELECTRON_MASS_KEV, (gridLastW-1.)*ELECTRON_MASS_KEV);
+  } else {
+    l->info("\n\nSpectrum calculated from {} keV to {} keV with {} step size {} keV\n",
+            (gridFirstW-1.)*ELECTRON_MASS_KEV, (gridLastW-1.)*ELECTRON_MASS_KEV, gridKind, gridStepW*ELECTRON_MASS_KEV);
+  }
+  if (gridLastW < W0 - 1e-9 && gridKind == "symmetric") {
+    l->info("The symmetric grid ends below the endpoint of {} keV, so f and log ft miss the top of the spectrum\n",
+            (W0-1.)*ELECTRON_MASS_KEV);
+  }
+  if (options.Exists("Spectrum.BinEdges")) {
+    l->info("Bin integrals written in {}.bins\n", outputName);
+  }
 
-  for (int i = 0; i < spectrum->size(); i++) {
-    if (GetBSGOpt(bool, Spectrum.Neutrino)) {
-      l->info("{:<10f}\t{:<10f}\t{:<10f}\t{:<10f}", (*spectrum)[i][0], ((*spectrum)[i][0]-1.)*ELECTRON_MASS_KEV, (*spectrum)[i][1], (*spectrum)[i][2]);
+  if (streaming) {
+    std::string format = options.Get<std::string>("format");
+    if (options.Exists("stdout") && format != "root") {
+      l->info("Spectrum not kept in memory, written to standard output");
+    } else if (format == "root") {
+      l->info("Spectrum not kept in memory, see {}", options.Get<std::string>("rootfile"));
     } else {
-      l->info("{:<10f}\t{:<10f}\t{:<10f}", (*spectrum)[i][0], ((*spectrum)[i][0]-1.)*ELECTRON_MASS_KEV, (*spectrum)[i][1]);
+      l->info("Spectrum not kept in memory, see {}.{}", outputName, format == "binary" ? "bin" : "raw");
     }
+    return;
+  }
+
+  if (options.Get<bool>("Spectrum.Neutrino"))  l->info("{:10}\t{:10}\t{:10}\t{:10}", "W [m_ec2]", "E [keV]", "dN_e/dW", "dN_v/dW");
+  else l->info("{:10}\t{:10}\t{:10}", "W [m_ec2]", "E [keV]", "dN_e/dW");
+
+  l->flush();
+  TextSpectrumWriter table(outputName + ".txt", options.Get<bool>("Spectrum.Neutrino"), true);
+  const std::vector<double>& W = spectrum.GetW();
+  const std::vector<double>& electron = spectrum.GetElectron();
+  const std::vector<double>& neutrino = spectrum.GetNeutrino();
+  for (std::size_t i = 0; i < spectrum.Size(); i++) {
+    table.Push(W[i], electron[i], neutrino[i]);
+  }
+  if (!table.Close()) {
+    if (outputError.empty()) outputError = table.GetError();
+    consoleLogger->error("{}", table.GetError());
+  }
+}
+
+bsg::SpectrumFileHeader bsg::Generator::GetFileHeader(std::size_t nPoints) {
+  SpectrumFileHeader header = SpectrumFileHeader();
+  header.betaType = betaType;
+  header.nPoints = nPoints;
+  header.optionsHash = options.GetOptionsHash();
+  header.Z = Z;
+  header.A = A;
+  header.R = R;
+  header.W0 = W0;
+  header.QValue = QValue;
+  header.mixingRatio = mixingRatio;
+  header.motherExcitationEn = motherExcitationEn;
+  header.daughterExcitationEn = daughterExcitationEn;
+  header.motherSpinParity = motherSpinParity;
+  header.daughterSpinParity = daughterSpinParity;
+  return header;
+}
+
+void bsg::Generator::WriteJsonSummary() {
+  std::ofstream json(outputName + ".json");
+  if (!json.is_open()) {
+    consoleLogger->error("Cannot write {}.json", outputName);
+    return;
+  }
+  AddOutputFile("json");
+  bool hasHalflife = options.Exists("Transition.PartialHalflife");
+  double halflife = hasHalflife ? options.Get<double>("Transition.PartialHalflife") : 1.0;
+
+  json << "{\n";
+  json << fmt::format("  \"version\": {},\n", JsonString(BSG_VERSION));
+  json << fmt::format("  \"output\": {},\n", JsonString(outputName));
+  json << fmt::format("  \"optionsHash\": \"{:016x}\",\n", options.GetOptionsHash());
+
+  json << "  \"transition\": {\n";
+  json << fmt::format("    \"process\": {},\n", JsonString(options.Get<std::string>("Transition.Process")));
+  json << fmt::format("    \"type\": {},\n", JsonString(options.Get<std::string>("Transition.Type")));
+  json << fmt::format("    \"Z\": {},\n", JsonNumber(Z));
+  json << fmt::format("    \"A\": {},\n", JsonNumber(A));
+  json << fmt::format("    \"motherSpinParity\": {},\n", motherSpinParity);
+  json << fmt::format("    \"daughterSpinParity\": {},\n", daughterSpinParity);
+  json << fmt::format("    \"motherExcitationEnergy\": {},\n", JsonNumber(motherExcitationEn));
+  json << fmt::format("    \"daughterExcitationEnergy\": {},\n", JsonNumber(daughterExcitationEn));
+  json << fmt::format("    \"QValue\": {},\n", JsonNumber(QValue));
+  json << fmt::format("    \"endpointEnergy\": {},\n", JsonNumber((W0-1.)*ELECTRON_MASS_KEV));
+  json << fmt::format("    \"mixingRatio\": {}\n", JsonNumber(mixingRatio));
+  json << "  },\n";
+
+  json << "  \"results\": {\n";
+  json << fmt::format("    \"f\": {},\n", JsonNumber(moments.GetMoment(0)));
+  json << fmt::format("    \"partialHalflife\": {},\n", hasHalflife ? JsonNumber(halflife) : "null");
+  json << fmt::format("    \"{}\": {},\n", hasHalflife ? "logFt" : "logF", JsonNumber(CalculateLogFtValue(halflife)));
+  json << fmt::format("    \"meanEnergy\": {}\n", JsonNumber((CalculateMeanEnergy()-1.)*ELECTRON_MASS_KEV));
+  json << "  },\n";
+
+  json << "  \"matrixElements\": {\n";
+  json << fmt::format("    \"bAc\": {},\n", JsonNumber(bAc));
+  json << fmt::format("    \"dAc\": {},\n", JsonNumber(dAc));
+  json << fmt::format("    \"lambda\": {}\n", JsonNumber(ratioM121));
+  json << "  },\n";
+
+  // the grid that was actually used, with energies in keV
+  json << "  \"grid\": {\n";
+  json << fmt::format("    \"kind\": {},\n", JsonString(gridKind));
+  json << fmt::format("    \"firstW\": {},\n", JsonNumber(gridFirstW));
+  json << fmt::format("    \"lastW\": {},\n", JsonNumber(gridLastW));
+  json << fmt::format("    \"begin\": {},\n", JsonNumber((gridFirstW-1.)*ELECTRON_MASS_KEV));
+  json << fmt::format("    \"end\": {},\n", JsonNumber((gridLastW-1.)*ELECTRON_MASS_KEV));
+  if (gridKind != "list") {
+    json << fmt::format("    \"step\": {},\n", JsonNumber(gridStepW*ELECTRON_MASS_KEV));
+  }
+  json << fmt::format("    \"points\": {}\n", nPoints);
+  json << "  },\n";
+
+  // the estimate is the largest relative error at the midpoints of the intervals, not a bound
+  if (deformationSpline.Size() > 0) {
+    json << "  \"deformationInterpolation\": {\n";
+    json << fmt::format("    \"nodes\": {},\n", deformationSpline.Size());
+    json << fmt::format("    \"tolerance\": {},\n", JsonNumber(options.Get<double>("Spectrum.ESDeformationTolerance")));
+    json << fmt::format("    \"midpointErrorEstimate\": {}\n", JsonNumber(deformationError));
+    json << "  },\n";
+  }
+
+  // corrections in the order in which they are applied, with the time spent in each
+  const std::vector<CorrectionKernel>& kernels = plan.GetKernels();
+  json << "  \"corrections\": [\n";
+  for (std::size_t k = 0; k < kernels.size(); k++) {
+    json << fmt::format("    {{\"name\": {}, \"seconds\": {}}}{}\n", JsonString(kernels[k].name),
+                        JsonNumber(k < correctionTimes.size() ? correctionTimes[k] : 0.),
+                        k + 1 < kernels.size() ? "," : "");
+  }
+  json << "  ],\n";
+
+  json << "  \"timings\": {\n";
+  double total = 0.;
+  for (const auto& p : phaseTimes) {
+    json << fmt::format("    {}: {},\n", JsonString(p.first), JsonNumber(p.second));
+    total += p.second;
   }
+  json << fmt::format("    \"total\": {}\n", JsonNumber(total));
+  json << "  }\n";
+  json << "}\n";
 }
@@ -0,0 +1,222 @@
+#include "ResultCache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include "spdlog/fmt/fmt.h"
+
+#include "BSGConfig.h"
+
+namespace {
+std::uint64_t Hash(const std::string& s) {
+  std::uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : s) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+/**
+ * Line of the key identifying the contents of a file, which may have been
+ * changed without changing its name
+ */
+std::string FileLine(const std::string& name, const std::string& fileName) {
+  std::ifstream file(fileName, std::ios::binary);
+  if (!file) {
+    return fmt::format("file:{}=missing\n", name);
+  }
+  std::ostringstream contents;
+  contents << file.rdbuf();
+  return fmt::format("file:{}={:016x}\n", name, Hash(contents.str()));
+}
+
+bool CopyFile(const std::string& from, const std::string& to) {
+  std::ifstream in(from, std::ios::binary);
+  std::ofstream out(to, std::ios::binary | std::ios::trunc);
+  if (!in || !out) return false;
+  out << in.rdbuf();
+  return (bool)out;
+}
+
+bool FileExists(const std::string& fileName) {
+  struct stat st;
+  return stat(fileName.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+/**
+ * Create a directory and its missing parents
+ */
+bool MakeDirectories(const std::string& path) {
+  for (std::size_t pos = path.find('/', 1); ; pos = path.find('/', pos + 1)) {
+    std::string parent = path.substr(0, pos);
+    if (mkdir(parent.c_str(), 0755) != 0 && errno != EEXIST) return false;
+    if (pos == std::string::npos) return true;
+  }
+}
+
+/**
+ * Remove a directory with the files in it
+ */
+void RemoveDirectory(const std::string& path) {
+  if (DIR* dir = opendir(path.c_str())) {
+    while (struct dirent* e = readdir(dir)) {
+      std::string name = e->d_name;
+      if (name != "." && name != "..") std::remove((path + "/" + name).c_str());
+    }
+    closedir(dir);
+  }
+  rmdir(path.c_str());
+}
+}
+
+bsg::ResultCache::ResultCache(std::string _directory, std::uint64_t _maxBytes)
+    : directory(_directory), maxBytes(_maxBytes) {}
+
+bsg::ResultCache bsg::ResultCache::FromOptions(const BSGOptions& options) {
+  // results that do not only consist of files named after the output can not be restored
+  if (options.Exists("no-cache") || options.Exists("stdout") || options.Get<std::string>("format") == "root") {
+    return ResultCache("", 0);
+  }
+  std::string directory = options.Get<std::string>("cache-dir");
+  if (directory.empty()) {
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME")) {
+      directory = std::string(xdg) + "/bsg";
+    } else if (const char* home = std::getenv("HOME")) {
+      directory = std::string(home) + "/.cache/bsg";
+    }
+  }
+  return ResultCache(directory, (std::uint64_t)(options.Get<double>("cache-size") * 1024 * 1024));
+}
+
+std::string bsg::ResultCache::GetKey(const BSGOptions& options) {
+  std::string key = "BSG " + std::string(BSG_VERSION) + "\n";
+  // the run control options that change the output files
+  key += "output=" + options.Get<std::string>("output") + "\n";
+  key += "format=" + options.Get<std::string>("format") + "\n";
+  key += fmt::format("stream={}\nbreakdown={}\n", options.Exists("stream"), options.Exists("breakdown"));
+  key += options.GetOptionsString();
+  if (options.Get<bool>("Spectrum.Exchange")) {
+    key += FileLine("exchangedata", options.Get<std::string>("exchangedata"));
+  }
+  if (options.Exists("Spectrum.EnergyList")) {
+    key += FileLine("Spectrum.EnergyList", options.Get<std::string>("Spectrum.EnergyList"));
+  }
+  if (options.Exists("Spectrum.BinEdges")) {
+    key += FileLine("Spectrum.BinEdges", options.Get<std::string>("Spectrum.BinEdges"));
+  }
+  const nme::NMEOptions& nmeOptions = options.GetNMEOptions();
+  if (nmeOptions.Exists("Transition.ROBTDFile")) {
+    key += FileLine("Transition.ROBTDFile", nmeOptions.Get<std::string>("Transition.ROBTDFile"));
+  }
+  return key;
+}
+
+const std::vector<std::string>& bsg::ResultCache::GetExtensions() {
+  static const std::vector<std::string> extensions = {"raw", "bin", "txt", "json", "breakdown", "bins", "nme"};
+  return extensions;
+}
+
+std::string bsg::ResultCache::GetEntry(const std::string& key) const {
+  return fmt::format("{}/{:016x}", directory, Hash(key));
+}
+
+bool bsg::ResultCache::Fetch(const std::string& key, const std::string& outputName) {
+  if (!IsEnabled()) return false;
+  std::string entry = GetEntry(key);
+  std::ifstream keyFile(entry + "/key", std::ios::binary);
+  std::ostringstream stored;
+  stored << keyFile.rdbuf();
+  // compare the full key, so that a collision of the hashes is a miss
+  if (!keyFile || stored.str() != key) return false;
+
+  std::remove((outputName + ".log").c_str());
+  for (const auto& ext : GetExtensions()) {
+    std::string output = outputName + "." + ext;
+    std::remove(output.c_str());
+    if (FileExists(entry + "/" + ext) && !CopyFile(entry + "/" + ext, output)) {
+      // e.g. evicted by another process in the meantime
+      for (const auto& e : GetExtensions()) std::remove((outputName + "." + e).c_str());
+      return false;
+    }
+  }
+  // the modification time of the key marks the last use
+  utime((entry + "/key").c_str(), nullptr);
+  return true;
+}
+
+bool bsg::ResultCache::Store(const std::string& key, const std::string& outputName,
+                             const std::vector<std::string>& extensions) {
+  if (!IsEnabled() || !MakeDirectories(directory)) return false;
+  std::string entry = GetEntry(key);
+  // the entry is filled under a temporary name, so that it appears complete or not at all
+  std::string tmp = fmt::format("{}/.tmp-{}-{:016x}", directory, getpid(), Hash(key));
+  if (mkdir(tmp.c_str(), 0755) != 0) return false;
+
+  bool complete = true;
+  for (const auto& ext : extensions) {
+    // skips files such as the .log, which are not part of the result
+    if (std::find(GetExtensions().begin(), GetExtensions().end(), ext) == GetExtensions().end()) continue;
+    complete = complete && CopyFile(outputName + "." + ext, tmp + "/" + ext);
+  }
+  std::ofstream keyFile(tmp + "/key", std::ios::binary);
+  keyFile << key;
+  keyFile.close();
+  complete = complete && (bool)keyFile;
+
+  // fails when the entry was added by another process in the meantime
+  if (!complete || rename(tmp.c_str(), entry.c_str()) != 0) {
+    RemoveDirectory(tmp);
+    return false;
+  }
+  // modification times have a resolution of a second, so the new entry may not sort last
+  Evict(key);
+  return true;
+}
+
+void bsg::ResultCache::Evict(const std::string& keep) {
+  if (!IsEnabled()) return;
+  struct Entry {
+    std::string path;
+    std::uint64_t bytes;
+    time_t lastUse;
+  };
+  std::vector<Entry> entries;
+  std::uint64_t total = 0;
+
+  DIR* dir = opendir(directory.c_str());
+  if (!dir) return;
+  while (struct dirent* e = readdir(dir)) {
+    // skips entries that are being filled
+    if (e->d_name[0] == '.') continue;
+    Entry entry = {directory + "/" + e->d_name, 0, 0};
+    struct stat st;
+    if (stat((entry.path + "/key").c_str(), &st) != 0) continue;
+    entry.lastUse = st.st_mtime;
+    for (const auto& name : GetExtensions()) {
+      if (stat((entry.path + "/" + name).c_str(), &st) == 0) entry.bytes += st.st_size;
+    }
+    total += entry.bytes;
+    entries.push_back(entry);
+  }
+  closedir(dir);
+  std::string kept = keep.empty() ? "" : GetEntry(keep);
+
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry& a, const Entry& b) { return a.lastUse < b.lastUse; });
+  for (const auto& entry : entries) {
+    if (total <= maxBytes) break;
+    if (entry.path == kept) continue;
+    RemoveDirectory(entry.path);
+    total -= entry.bytes;
+  }
+}
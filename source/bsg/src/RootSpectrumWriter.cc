@@ -0,0 +1,107 @@
+#include "RootSpectrumWriter.h"
+#include "Constants.h"
+#include "Utilities.h"
+
+#include <mutex>
+
+#include "TFile.h"
+#include "TObject.h"
+#include "TTree.h"
+
+namespace {
+/**
+ * Held while a writer extends a ROOT file
+ */
+std::mutex writerMutex;
+
+const char* pointNames[] = {"W", "E", "electron", "neutrino"};
+const char* valueNames[] = {"Z", "A", "W0", "QValue", "f", "logFt", "meanEnergy", "bAc", "dAc", "lambda"};
+
+/**
+ * Connect a buffer to a branch of an existing tree, or create the branch for a new tree
+ */
+void Connect(TTree* tree, bool existing, const char* name, void* address, const char* type) {
+  if (existing) {
+    tree->SetBranchAddress(name, address);
+  } else {
+    tree->Branch(name, address, (std::string(name) + "/" + type).c_str());
+  }
+}
+}
+
+bsg::RootSpectrumWriter::RootSpectrumWriter(std::string _fileName)
+    : fileName(_fileName), summary(), hasSummary(false), closed(false) {}
+
+bsg::RootSpectrumWriter::~RootSpectrumWriter() { Close(); }
+
+void bsg::RootSpectrumWriter::WriteSummary(const SpectrumSummary& _summary) {
+  summary = _summary;
+  hasSummary = true;
+}
+
+bool bsg::RootSpectrumWriter::Close() {
+  if (closed) return error.empty();
+  closed = true;
+
+  std::lock_guard<std::mutex> writerLock(writerMutex);
+  std::lock_guard<std::mutex> lock(utilities::GetRootMutex());
+  TFile* file = TFile::Open(fileName.c_str(), "UPDATE");
+  if (!file || file->IsZombie()) {
+    delete file;
+    error = "Cannot open ROOT file " + fileName;
+    return false;
+  }
+  file->cd();
+  TTree* spectrumTree = nullptr;
+  TTree* summaryTree = nullptr;
+  file->GetObject("spectrum", spectrumTree);
+  file->GetObject("summary", summaryTree);
+  bool existing = spectrumTree && summaryTree;
+  if (!existing) {
+    spectrumTree = new TTree("spectrum", "Beta spectra, one entry per grid point");
+    summaryTree = new TTree("summary", "Calculated transitions, one entry per spectrum");
+  }
+
+  // buffers connected to the branches; the strings are connected with their
+  // full length, so that nothing is cut off
+  int transition = summaryTree->GetEntries();
+  double point[4];  // W, kinetic energy in keV, electron and neutrino decay rate
+  double values[] = {summary.Z, summary.A, summary.W0, summary.QValue, summary.f, summary.logFt,
+                     summary.meanEnergy, summary.bAc, summary.dAc, summary.lambda};
+  int betaType = summary.betaType;
+  unsigned long long optionsHash = summary.optionsHash;
+  std::string name = summary.name;
+  std::string options = summary.options;
+
+  Connect(spectrumTree, existing, "transition", &transition, "I");
+  for (int i = 0; i < 4; i++) {
+    Connect(spectrumTree, existing, pointNames[i], &point[i], "D");
+  }
+
+  Connect(summaryTree, existing, "name", &name[0], "C");
+  Connect(summaryTree, existing, "options", &options[0], "C");
+  Connect(summaryTree, existing, "optionsHash", &optionsHash, "l");
+  Connect(summaryTree, existing, "betaType", &betaType, "I");
+  for (int i = 0; i < 10; i++) {
+    Connect(summaryTree, existing, valueNames[i], &values[i], "D");
+  }
+
+  for (std::size_t i = 0; i < points.Size(); i++) {
+    point[0] = points.GetW()[i];
+    point[1] = (point[0] - 1.) * ELECTRON_MASS_KEV;
+    point[2] = points.GetElectron()[i];
+    point[3] = points.GetNeutrino()[i];
+    spectrumTree->Fill();
+  }
+  if (hasSummary) {
+    summaryTree->Fill();
+  }
+
+  spectrumTree->Write("", TObject::kOverwrite);
+  summaryTree->Write("", TObject::kOverwrite);
+  // the trees are owned by the file and deleted with it
+  file->Close();
+  delete file;
+  points.Clear();
+  return true;
+}
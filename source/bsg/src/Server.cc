@@ -0,0 +1,383 @@
+#include "Server.h"
+#include "Batch.h"
+#include "Generator.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <sstream>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "boost/algorithm/string.hpp"
+#include "spdlog/spdlog.h"
+#include "spdlog/fmt/fmt.h"
+
+namespace {
+/**
+ * Read the options of a request, given in the form of an input or
+ * configuration file. Values of an option given on several lines are
+ * joined, as for the vector options.
+ *
+ * @returns an empty string, or the reason the text cannot be read
+ */
+std::string ParseRequest(const std::string& text, bsg::OptionValues& values) {
+  std::istringstream stream(text);
+  std::string line;
+  std::string section;
+  for (int lineNumber = 1; std::getline(stream, line); lineNumber++) {
+    std::size_t comment = line.find('#');
+    if (comment != std::string::npos) line.erase(comment);
+    boost::trim(line);
+    if (line.empty()) continue;
+    if (line[0] == '[') {
+      if (line.back() != ']') return fmt::format("line {}: section header is not closed", lineNumber);
+      section = boost::trim_copy(line.substr(1, line.size() - 2));
+      continue;
+    }
+    std::size_t equals = line.find('=');
+    if (equals == std::string::npos) return fmt::format("line {}: expected name = value", lineNumber);
+    std::string name = boost::trim_copy(line.substr(0, equals));
+    std::string value = boost::trim_copy(line.substr(equals + 1));
+    if (!section.empty()) name = section + "." + name;
+    if (value.empty()) continue;
+    auto previous = std::find_if(values.begin(), values.end(),
+                                 [&name](const std::pair<std::string, std::string>& v) { return v.first == name; });
+    if (previous != values.end()) {
+      previous->second += " " + value;
+    } else {
+      values.push_back(std::make_pair(name, value));
+    }
+  }
+  return "";
+}
+
+bool ReadFully(int fd, char* data, std::size_t size) {
+  while (size > 0) {
+    ssize_t n = ::read(fd, data, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool WriteFully(int fd, const char* data, std::size_t size) {
+  while (size > 0) {
+    // a client that went away must not kill the server with SIGPIPE
+    ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+/**
+ * Payload of a "RSLT" message
+ */
+std::string EncodeSpectrum(const bsg::Spectrum& spectrum) {
+  std::uint64_t n = spectrum.Size();
+  std::string payload(sizeof(n) + 3 * n * sizeof(double), '\0');
+  char* p = &payload[0];
+  std::memcpy(p, &n, sizeof(n));
+  p += sizeof(n);
+  for (const std::vector<double>* column : {&spectrum.GetW(), &spectrum.GetElectron(), &spectrum.GetNeutrino()}) {
+    if (n > 0) std::memcpy(p, column->data(), n * sizeof(double));
+    p += n * sizeof(double);
+  }
+  return payload;
+}
+
+void Send(int fd, std::mutex& writeMutex, const char* type, std::uint32_t id, const std::string& payload) {
+  bsg::ServerMessageHeader header;
+  std::memcpy(header.type, type, sizeof(header.type));
+  header.id = id;
+  header.flags = 0;
+  header.size = payload.size();
+  std::lock_guard<std::mutex> lock(writeMutex);
+  if (WriteFully(fd, (const char*)&header, sizeof(header))) {
+    WriteFully(fd, payload.data(), payload.size());
+  }
+}
+}
+
+bsg::SpectrumServer::Connection::~Connection() { ::close(fd); }
+
+bsg::SpectrumServer::SpectrumServer(int argc, char** argv, BSGOptionContainer& container, std::string _workDir,
+                                    int _nWorkers, bool _keepOutput)
+    : program(argc > 0 ? argv[0] : "bsg_server"),
+      workDir(_workDir),
+      nWorkers(_nWorkers),
+      keepOutput(_keepOutput),
+      nRequests(0),
+      listenFd(-1),
+      stopping(false),
+      nReaders(0) {
+  if (nWorkers <= 0) {
+    nWorkers = std::max(1, (int)std::thread::hardware_concurrency());
+  }
+  // options that are given per request, or that would keep the spectrum out of memory
+  sharedArguments = container.GetArguments(argc, argv, {"help", "version", "input", "output", "batch", "table",
+                                                        "jobs", "stream", "stdout", "format", "rootfile",
+                                                        "checkpoint", "resume"});
+}
+
+bsg::SpectrumServer::~SpectrumServer() {
+  if (listenFd >= 0) {
+    ::close(listenFd);
+    ::unlink(socketPath.c_str());
+  }
+}
+
+bool bsg::SpectrumServer::Listen(std::string path) {
+  error.clear();
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    error = "Socket path " + path + " is too long";
+    return false;
+  }
+  std::strcpy(address.sun_path, path.c_str());
+
+  struct stat info;
+  if (::stat(path.c_str(), &info) == 0) {
+    if (!S_ISSOCK(info.st_mode)) {
+      error = path + " exists and is not a socket";
+      return false;
+    }
+    int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    bool inUse = probe >= 0 && ::connect(probe, (sockaddr*)&address, sizeof(address)) == 0;
+    if (probe >= 0) ::close(probe);
+    if (inUse) {
+      error = "Another server is listening on " + path;
+      return false;
+    }
+    // left behind by a server that no longer runs
+    ::unlink(path.c_str());
+  }
+
+  listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listenFd < 0 || ::bind(listenFd, (sockaddr*)&address, sizeof(address)) != 0 || ::listen(listenFd, 64) != 0) {
+    error = fmt::format("Cannot listen on {}: {}", path, std::strerror(errno));
+    if (listenFd >= 0) ::close(listenFd);
+    listenFd = -1;
+    return false;
+  }
+  socketPath = path;
+  return true;
+}
+
+void bsg::SpectrumServer::Serve(const std::atomic<bool>& stop) {
+  std::vector<std::thread> workers;
+  for (int w = 0; w < nWorkers; w++) {
+    workers.push_back(std::thread(&SpectrumServer::Work, this, nWorkers > 1 && w == 0));
+  }
+
+  while (!stop) {
+    pollfd listening = {listenFd, POLLIN, 0};
+    if (::poll(&listening, 1, 200) <= 0) continue;
+    int fd = ::accept(listenFd, nullptr, nullptr);
+    if (fd < 0) continue;
+    auto connection = std::make_shared<Connection>(fd);
+    {
+      std::lock_guard<std::mutex> lock(connectionsMutex);
+      connections.insert(connection);
+      nReaders++;
+    }
+    std::thread(&SpectrumServer::ReadMessages, this, connection).detach();
+  }
+
+  ::close(listenFd);
+  ::unlink(socketPath.c_str());
+  listenFd = -1;
+
+  // running calculations are cancelled and all requests are answered while
+  // the clients are still connected
+  std::vector<std::shared_ptr<Request> > queued;
+  {
+    std::lock_guard<std::mutex> connectionsLock(connectionsMutex);
+    std::lock_guard<std::mutex> queueLock(queueMutex);
+    stopping = true;
+    for (const auto& connection : connections) {
+      for (auto& request : connection->requests) request.second->cancelled = true;
+    }
+    for (auto* queue : {&interactive, &batch}) {
+      queued.insert(queued.end(), queue->begin(), queue->end());
+      queue->clear();
+    }
+  }
+  queueCondition.notify_all();
+  for (auto& request : queued) {
+    Answer(*request, "FAIL", "cancelled");
+  }
+  for (auto& w : workers) {
+    w.join();
+  }
+
+  std::unique_lock<std::mutex> lock(connectionsMutex);
+  for (const auto& connection : connections) {
+    ::shutdown(connection->fd, SHUT_RDWR);
+  }
+  readersCondition.wait(lock, [this] { return nReaders == 0; });
+}
+
+void bsg::SpectrumServer::ReadMessages(std::shared_ptr<Connection> connection) {
+  ServerMessageHeader header;
+  std::string payload;
+  while (ReadFully(connection->fd, (char*)&header, sizeof(header))) {
+    if (header.size > SERVER_MAX_PAYLOAD) {
+      spdlog::warn("Disconnecting a client that sent a message of {} bytes", header.size);
+      break;
+    }
+    payload.resize(header.size);
+    if (header.size > 0 && !ReadFully(connection->fd, &payload[0], header.size)) break;
+
+    std::string type(header.type, sizeof(header.type));
+    if (type == "SPEC") {
+      Submit(connection, header, payload);
+    } else if (type == "CNCL") {
+      Cancel(connection, header.id);
+    } else {
+      Send(connection->fd, connection->writeMutex, "FAIL", header.id, "unknown message type " + type);
+    }
+  }
+
+  // nobody is waiting for the answers anymore
+  {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    for (auto it = connection->requests.begin(); it != connection->requests.end();) {
+      std::shared_ptr<Request> request = it->second;
+      request->cancelled = true;
+      if (request->running) {
+        // removed by its worker when it stops
+        ++it;
+        continue;
+      }
+      for (auto* queue : {&interactive, &batch}) {
+        queue->erase(std::remove(queue->begin(), queue->end(), request), queue->end());
+      }
+      it = connection->requests.erase(it);
+    }
+  }
+  // notified while holding the lock, as Serve may return and the server be
+  // destroyed as soon as it is released
+  std::lock_guard<std::mutex> lock(connectionsMutex);
+  connections.erase(connection);
+  nReaders--;
+  readersCondition.notify_all();
+}
+
+void bsg::SpectrumServer::Submit(const std::shared_ptr<Connection>& connection, const ServerMessageHeader& header,
+                                 const std::string& payload) {
+  auto request = std::make_shared<Request>();
+  request->id = header.id;
+  request->connection = connection;
+  std::string problem = ParseRequest(payload, request->values);
+  if (problem.empty()) {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if (stopping) {
+      problem = "cancelled";
+    } else if (connection->requests.count(header.id)) {
+      problem = fmt::format("request id {} is in use", header.id);
+    } else {
+      connection->requests[header.id] = request;
+      (header.flags & SERVER_BATCH ? batch : interactive).push_back(request);
+    }
+  }
+  if (!problem.empty()) {
+    Send(connection->fd, connection->writeMutex, "FAIL", header.id, problem);
+    return;
+  }
+  queueCondition.notify_all();
+}
+
+void bsg::SpectrumServer::Cancel(const std::shared_ptr<Connection>& connection, std::uint32_t id) {
+  std::shared_ptr<Request> request;
+  {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    auto it = connection->requests.find(id);
+    // already answered
+    if (it == connection->requests.end()) return;
+    request = it->second;
+    request->cancelled = true;
+    // answered by its worker once the calculation stops
+    if (request->running) return;
+    for (auto* queue : {&interactive, &batch}) {
+      queue->erase(std::remove(queue->begin(), queue->end(), request), queue->end());
+    }
+  }
+  Answer(*request, "FAIL", "cancelled");
+}
+
+void bsg::SpectrumServer::Work(bool interactiveOnly) {
+  while (true) {
+    std::shared_ptr<Request> request;
+    {
+      std::unique_lock<std::mutex> lock(queueMutex);
+      queueCondition.wait(lock, [&] {
+        return stopping || !interactive.empty() || (!interactiveOnly && !batch.empty());
+      });
+      if (stopping) return;
+      std::deque<std::shared_ptr<Request> >& queue = interactive.empty() ? batch : interactive;
+      request = queue.front();
+      queue.pop_front();
+      request->running = true;
+    }
+    Calculate(*request);
+  }
+}
+
+void bsg::SpectrumServer::Calculate(Request& request) {
+  std::string output = fmt::format("{}/bsg_server_{}_{}", workDir, ::getpid(), nRequests++);
+  std::vector<std::string> arguments = {program, "--output", output};
+  arguments.insert(arguments.end(), sharedArguments.begin(), sharedArguments.end());
+  std::vector<char*> argv;
+  for (auto& a : arguments) argv.push_back(&a[0]);
+
+  try {
+    BSGOptions options = BSGOptionContainer((int)argv.size(), argv.data(), &request.values).GetOptions();
+    std::string problem = CheckTransition(options);
+    if (!problem.empty()) {
+      Answer(request, "FAIL", problem);
+    } else {
+      std::string payload;
+      {
+        Generator gen(options);
+        // the set-up of the nuclear structure cannot be interrupted
+        if (request.cancelled) throw CalculationCancelled();
+        gen.SetCancelFlag(&request.cancelled);
+        payload = EncodeSpectrum(gen.CalculateSpectrum());
+        // the output files are closed with the generator
+      }
+      Answer(request, "RSLT", payload);
+    }
+  } catch (CalculationCancelled&) {
+    Answer(request, "FAIL", "cancelled");
+  } catch (std::exception& e) {
+    Answer(request, "FAIL", e.what());
+  }
+
+  if (!keepOutput) {
+    for (const char* extension : {".log", ".raw", ".txt", ".json", ".nme", ".breakdown", ".bins", ".ckpt"}) {
+      std::remove((output + extension).c_str());
+    }
+  }
+}
+
+void bsg::SpectrumServer::Answer(Request& request, const char* type, const std::string& payload) {
+  {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    request.connection->requests.erase(request.id);
+  }
+  Send(request.connection->fd, request.connection->writeMutex, type, request.id, payload);
+}
@@ -4,6 +4,8 @@
 #include "ChargeDistributions.h"
 #include "Screening.h"
 
+#include "BSGConfig.h"
+
 #include <complex>
 #include <stdio.h>
 
@@ -22,6 +24,36 @@
 using std::cout;
 using std::endl;
 
+/**
+ * Calculate @f$ \ln|\Gamma(x+iy)| @f$ for @f$ x > 0 @f$ using GSL, or the
+ * built-in implementation when BSG_FAST_LNGAMMA is turned on
+ */
+inline double LnGammaMagnitude(double x, double y) {
+#ifdef BSG_FAST_LNGAMMA
+  return bsg::utilities::LnGammaComplexMagnitude(x, y);
+#else
+  gsl_sf_result magn;
+  gsl_sf_result phase;
+  gsl_sf_lngamma_complex_e(x, y, &magn, &phase);
+  return magn.val;
+#endif
+}
+
+/**
+ * As LnGammaMagnitude, for arguments whose real part may be negative, e.g.
+ * in the screening correction, which are always passed to GSL because they
+ * lie outside the domain of the built-in implementation
+ */
+inline double LnGammaMagnitudeAnyX(double x, double y) {
+#ifdef BSG_FAST_LNGAMMA
+  if (x > 0.) return bsg::utilities::LnGammaComplexMagnitude(x, y);
+#endif
+  gsl_sf_result magn;
+  gsl_sf_result phase;
+  gsl_sf_lngamma_complex_e(x, y, &magn, &phase);
+  return magn.val;
+}
+
 double bsg::SpectralFunctions::PhaseSpace(double W, double W0, int motherSpinParity,
                                      int daughterSpinParity) {
   double result = std::sqrt(W * W - 1.) * W * std::pow(W0 - W, 2.);
@@ -41,13 +73,10 @@ double bsg::SpectralFunctions::FermiFunction(double W, int Z, double R,
 
   // the fifth is a bit tricky
   // we use the complex gamma function from GSL
-  gsl_sf_result magn;
-  gsl_sf_result phase;
-  gsl_sf_lngamma_complex_e(gamma, betaType * ALPHA * Z * W / p, &magn, &phase);
-  // now we have what we wAt in magn.val
+  double magn = LnGammaMagnitude(gamma, betaType * ALPHA * Z * W / p);
 
   // but we incorporate the second term here as well
-  double fifth = std::exp(2. * (magn.val - gsl_sf_lngamma(2. * gamma + 1.)));
+  double fifth = std::exp(2. * (magn - gsl_sf_lngamma(2. * gamma + 1.)));
 
   double result = first * third * fourth * fifth;
   return result;
@@ -59,33 +88,50 @@ double bsg::SpectralFunctions::CCorrection(double W, double W0, int Z, int A,
                                       double fc1, double fb, double fd,
                                       double ratioM121, bool addCI,
                                       std::string NSShape, double hoFit) {
+  return CCorrection(W, CalculateCCorrectionCoefficients(W0, Z, A, R, betaType, decayType,
+                                                         gA, gP, fc1, fb, fd, ratioM121,
+                                                         NSShape, hoFit),
+                     addCI);
+}
+
+double bsg::SpectralFunctions::CCorrection(
+    double W, double W0, int Z, int A, double R, int betaType,
+    int decayType, double gA, double gP, double fc1, double fb, double fd,
+    double ratioM121, bool addCI, std::string NSShape, double hoFit,
+    nme::NuclearStructure::SingleParticleState& spsi,
+    nme::NuclearStructure::SingleParticleState& spsf) {
+  return CCorrection(W, CalculateCCorrectionCoefficients(W0, Z, A, R, betaType, decayType,
+                                                         gA, gP, fc1, fb, fd, ratioM121,
+                                                         NSShape, hoFit),
+                     addCI, spsi, spsf);
+}
+
+double bsg::SpectralFunctions::CCorrection(double W,
+    const CCorrectionCoefficients& coefficients, bool addCI) {
   double cShape, cNS;
-  std::tie(cShape, cNS) =
-      CCorrectionComponents(W, W0, Z, A, R, betaType, decayType, gA, gP,
-                            fc1, fb, fd, ratioM121, NSShape, hoFit);
+  std::tie(cShape, cNS) = CCorrectionComponents(W, coefficients);
   double result = 0.;
   if (addCI) {
-    result = cShape * CICorrection(W, W0, Z, A, R, betaType) + cNS;
+    result = cShape * CICorrection(W, coefficients.W0, coefficients.Z,
+                                   coefficients.A, coefficients.R,
+                                   coefficients.betaType) + cNS;
   } else {
     result = cShape + cNS;
   }
   return result;
 }
 
-double bsg::SpectralFunctions::CCorrection(
-    double W, double W0, int Z, int A, double R, int betaType,
-    int decayType, double gA, double gP, double fc1, double fb, double fd,
-    double ratioM121, bool addCI, std::string NSShape, double hoFit,
+double bsg::SpectralFunctions::CCorrection(double W,
+    const CCorrectionCoefficients& coefficients, bool addCI,
     nme::NuclearStructure::SingleParticleState& spsi,
     nme::NuclearStructure::SingleParticleState& spsf) {
-
   double cShape, cNS;
-  std::tie(cShape, cNS) =
-      CCorrectionComponents(W, W0, Z, A, R, betaType, decayType, gA, gP,
-                            fc1, fb, fd, ratioM121, NSShape, hoFit);
+  std::tie(cShape, cNS) = CCorrectionComponents(W, coefficients);
   double result = 0.;
   if (addCI) {
-    result = cShape * CICorrection(W, W0, Z, R, betaType, spsi, spsf) + cNS;
+    result = cShape * CICorrection(W, coefficients.W0, coefficients.Z,
+                                   coefficients.R, coefficients.betaType,
+                                   spsi, spsf) + cNS;
   } else {
     result = cShape + cNS;
   }
@@ -96,6 +142,40 @@ std::tuple<double, double> bsg::SpectralFunctions::CCorrectionComponents(
     double W, double W0, int Z, int A, double R, int betaType, int decayType,
     double gA, double gP, double fc1, double fb, double fd,
     double ratioM121, std::string NSShape, double hoFit) {
+  return CCorrectionComponents(W, CalculateCCorrectionCoefficients(W0, Z, A, R, betaType,
+                                                                   decayType, gA, gP, fc1, fb,
+                                                                   fd, ratioM121, NSShape, hoFit));
+}
+
+std::tuple<double, double> bsg::SpectralFunctions::CCorrectionComponents(
+    double W, const CCorrectionCoefficients& c) {
+  double cShape = 0.;
+  if (c.hasShape) {
+    cShape = 1. + c.S0 + c.S1 * W + c.Sm1 / W + c.S2 * W * W;
+  }
+
+  double cNS = 0;
+  if (c.hasNS) {
+    cNS = c.NS0 + c.NS1 * W + c.NSm1 / W + c.NS2 * W * W;
+
+    cNS += c.phi*(c.P0 + c.P1 * W + c.Pm1 / W);
+  }
+
+  return std::make_tuple(cShape, cNS);
+}
+
+bsg::SpectralFunctions::CCorrectionCoefficients
+bsg::SpectralFunctions::CalculateCCorrectionCoefficients(
+    double W0, int Z, int A, double R, int betaType, int decayType,
+    double gA, double gP, double fc1, double fb, double fd,
+    double ratioM121, std::string NSShape, double hoFit) {
+  CCorrectionCoefficients c = {};
+  c.W0 = W0;
+  c.Z = Z;
+  c.A = A;
+  c.R = R;
+  c.betaType = betaType;
+
   double AC0, AC1, ACm1, AC2;
   double VC0, VC1, VCm1, VC2;
 
@@ -133,76 +213,68 @@ std::tuple<double, double> bsg::SpectralFunctions::CCorrectionComponents(
 
   AC2 = -4. / 9. * R * R;
 
-  double cShape = 0.;
-
   if (decayType == FERMI) {
-    cShape = 1. + VC0 + VC1 * W + VCm1 / W + VC2 * W * W;
+    c.hasShape = true;
+    c.S0 = VC0;
+    c.S1 = VC1;
+    c.Sm1 = VCm1;
+    c.S2 = VC2;
   } else if (decayType == GAMOW_TELLER) {
-    cShape = 1. + AC0 + AC1 * W + ACm1 / W + AC2 * W * W;
+    c.hasShape = true;
+    c.S0 = AC0;
+    c.S1 = AC1;
+    c.Sm1 = ACm1;
+    c.S2 = AC2;
   }
 
-  double cNS = 0;
   if (decayType == GAMOW_TELLER) {
+    c.hasNS = true;
     double M = A * NUCLEON_MASS_KEV / ELECTRON_MASS_KEV;
 
     double Lambda = std::sqrt(2.)/3.*10.*ratioM121;
 
-    double phi = gP/gA/sqr(2.*M*R/A);
+    c.phi = gP/gA/sqr(2.*M*R/A);
 
-    double NSC0 = -1. / 45. * R * R * Lambda +
-                  1. / 3. * W0 / M / fc1 * (-betaType * 2. * fb + fd) +
-                  betaType * 2. / 5. * ALPHA * Z / M / R / fc1 *
-                      (betaType * 2. * fb + fd) -
-                  betaType * 2. / 35. * ALPHA * Z * W0 * R * Lambda;
+    c.NS0 = -1. / 45. * R * R * Lambda +
+            1. / 3. * W0 / M / fc1 * (-betaType * 2. * fb + fd) +
+            betaType * 2. / 5. * ALPHA * Z / M / R / fc1 *
+                (betaType * 2. * fb + fd) -
+            betaType * 2. / 35. * ALPHA * Z * W0 * R * Lambda;
 
-    double NSC1 = betaType * 4. / 3. * fb / M / fc1 -
-                  2. / 45. * W0 * R * R * Lambda +
-                  betaType * ALPHA * Z * R * 2. / 35. * Lambda;
+    c.NS1 = betaType * 4. / 3. * fb / M / fc1 -
+            2. / 45. * W0 * R * R * Lambda +
+            betaType * ALPHA * Z * R * 2. / 35. * Lambda;
 
-    double NSCm1 = -1. / 3. / M / fc1 * (betaType * 2. * fb + fd) +
-                   2. / 45. * W0 * R * R * Lambda;
+    c.NSm1 = -1. / 3. / M / fc1 * (betaType * 2. * fb + fd) +
+             2. / 45. * W0 * R * R * Lambda;
 
-    double NSC2 = 2. / 45. * R * R * Lambda;
+    c.NS2 = 2. / 45. * R * R * Lambda;
 
     double gamma = std::sqrt(1.-sqr(ALPHA*Z));
 
-    double P0 = betaType*2./25.*ALPHA*Z*R*W0 + 51./250.*sqr(ALPHA*Z);
-    double P1 = betaType*2./25.*ALPHA*Z*R;
-    double Pm1 = -2./3.*gamma*W0*R*R+betaType*26./25.*ALPHA*Z*R*gamma;
-
-    cNS = NSC0 + NSC1 * W + NSCm1 / W + NSC2 * W * W;
-
-    cNS += phi*(P0 + P1 * W + Pm1 / W);
+    c.P0 = betaType*2./25.*ALPHA*Z*R*W0 + 51./250.*sqr(ALPHA*Z);
+    c.P1 = betaType*2./25.*ALPHA*Z*R;
+    c.Pm1 = -2./3.*gamma*W0*R*R+betaType*26./25.*ALPHA*Z*R*gamma;
   }
 
-  return std::make_tuple(cShape, cNS);
+  return c;
 }
 
-double bsg::SpectralFunctions::CICorrection(double W, double W0, int Z, int A,
-                                       double R, int betaType) {
-  double AC0, AC1, AC2, ACm1;
-  double VC0, VC1, VC2, VCm1;
-
-  double rms = std::sqrt(3. / 5.) * R;
-  double nu = 0.;
-
-  int nN, lN, nZ, lZ;
-  std::vector<int> occNumbersN =
-      utilities::GetOccupationNumbers(A - (Z - betaType));
-  nN = occNumbersN[occNumbersN.size() - 1 - 3];
-  lN = occNumbersN[occNumbersN.size() - 1 - 2];
-  std::vector<int> occNumbersZ = utilities::GetOccupationNumbers(Z - betaType);
-  nZ = occNumbersZ[occNumbersZ.size() - 1 - 3];
-  lZ = occNumbersZ[occNumbersZ.size() - 1 - 2];
-
-  // cout << "nZ: " << nZ << " lZ: " << lZ << " p: " <<
-  // occNumbersZ[occNumbersZ.size() - 1] << endl;
-
-  double w = (4 * nZ + 2 * lZ - 1) / 5.;
-  double V0 = betaType * 3 * ALPHA * Z / 2. / R;
-  double e = (sqr(W0 - W) + sqr(W + V0) - 1) / 6.;
+namespace {
+/**
+ * W-independent parameters of the isovector correction for a uniformly
+ * charged sphere, from the occupation numbers of the daughter protons
+ *
+ * @param w (4n + 2l - 1)/5 of the last proton orbital
+ * @param Ap
+ */
+void UniformCIParameters(int Z, int betaType, double& w, double& Ap) {
+  std::vector<int> occNumbersZ = bsg::utilities::GetOccupationNumbers(Z - betaType);
+  int nZ = occNumbersZ[occNumbersZ.size() - 1 - 3];
+  int lZ = occNumbersZ[occNumbersZ.size() - 1 - 2];
+
+  w = (4 * nZ + 2 * lZ - 1) / 5.;
 
-  double Ap = 1.;
   double sum = 0.;
   for (int j = 0; j < occNumbersZ.size(); j += 4) {
     if (occNumbersZ[j + 1] == 0) {
@@ -210,45 +282,85 @@ double bsg::SpectralFunctions::CICorrection(double W, double W0, int Z, int A,
     }
   }
   Ap = (2. * (Z - betaType) / sum - 2.) / 3.;
+}
 
-  // cout << "Ap: " << Ap << endl;
+double UniformCICorrection(double W, double W0, int Z, double R, int betaType, double w, double Ap) {
+  double V0 = betaType * 3 * bsg::ALPHA * Z / 2. / R;
+  double e = (sqr(W0 - W) + sqr(W + V0) - 1) / 6.;
 
   return 1 - 8. / 5. * w * e * R * R / (5. * Ap + 2);
 }
 
-double bsg::SpectralFunctions::CICorrection(
-    double W, double W0, double Z, double R, int betaType,
-    nme::NuclearStructure::SingleParticleState& spsi,
-    nme::NuclearStructure::SingleParticleState& spsf) {
-  double V0 = betaType * 3. * Z * ALPHA / 2. / R;
-  double epsilon = 1. / 6. * (sqr(W0 - W) + sqr(W + V0) - 1.);
-
-  double nu = ChargeDistributions::CalcNu(R * std::sqrt(3. / 5.), Z);
-
-  double result = 0.;
-
-  double C = 0.;
+/**
+ * Overlap of an initial and final harmonic oscillator component with the same n and l
+ */
+struct HOOverlap {
+  double weight; /**< product of the squared expansion coefficients */
+  double I; /**< radial matrix element of r^0 */
+  double r2; /**< radial matrix element of r^2 */
+};
+
+/**
+ * W-independent radial matrix elements of the isovector correction with single-particle wave functions
+ *
+ * @param C set to the sum of the weights
+ */
+std::vector<HOOverlap> CalculateHOOverlaps(double Z, double R, nme::NuclearStructure::SingleParticleState& spsi,
+                                           nme::NuclearStructure::SingleParticleState& spsf, double& C) {
+  double nu = bsg::ChargeDistributions::CalcNu(R * std::sqrt(3. / 5.), Z);
+
+  std::vector<HOOverlap> overlaps;
+  C = 0.;
   for (int i = 0; i < spsi.componentsHO.size(); i++) {
     for (int j = 0; j < spsf.componentsHO.size(); j++) {
       if ((spsf.componentsHO[j].n == spsi.componentsHO[i].n) &&
           (spsf.componentsHO[j].l == spsi.componentsHO[i].l)) {
-        double I = ChargeDistributions::GetRadialMEHO(
+        HOOverlap o;
+        o.weight = sqr(spsf.componentsHO[j].C * spsi.componentsHO[i].C);
+        o.I = bsg::ChargeDistributions::GetRadialMEHO(
             spsf.componentsHO[j].n, spsf.componentsHO[j].l, 0,
             spsi.componentsHO[i].n, spsi.componentsHO[i].l, nu);
-        double r2 = ChargeDistributions::GetRadialMEHO(
+        o.r2 = bsg::ChargeDistributions::GetRadialMEHO(
             spsf.componentsHO[j].n, spsf.componentsHO[j].l, 2,
             spsi.componentsHO[i].n, spsi.componentsHO[i].l, nu);
-
-        result += sqr(spsf.componentsHO[j].C * spsi.componentsHO[i].C) * I *
-                  (I - 2. * epsilon * r2);
-        C += sqr(spsf.componentsHO[j].C * spsi.componentsHO[i].C);
+        overlaps.push_back(o);
+        C += o.weight;
       }
     }
   }
+  return overlaps;
+}
+
+double HOCICorrection(double W, double W0, double Z, double R, int betaType,
+                      const std::vector<HOOverlap>& overlaps, double C) {
+  double V0 = betaType * 3. * Z * bsg::ALPHA / 2. / R;
+  double epsilon = 1. / 6. * (sqr(W0 - W) + sqr(W + V0) - 1.);
+
+  double result = 0.;
+  for (const auto& o : overlaps) {
+    result += o.weight * o.I * (o.I - 2. * epsilon * o.r2);
+  }
   result *= (1. + 6. / 5. * epsilon * R * R) / C;
 
   return result;
 }
+}
+
+double bsg::SpectralFunctions::CICorrection(double W, double W0, int Z, int A,
+                                       double R, int betaType) {
+  double w, Ap;
+  UniformCIParameters(Z, betaType, w, Ap);
+  return UniformCICorrection(W, W0, Z, R, betaType, w, Ap);
+}
+
+double bsg::SpectralFunctions::CICorrection(
+    double W, double W0, double Z, double R, int betaType,
+    nme::NuclearStructure::SingleParticleState& spsi,
+    nme::NuclearStructure::SingleParticleState& spsf) {
+  double C;
+  std::vector<HOOverlap> overlaps = CalculateHOOverlaps(Z, R, spsi, spsf, C);
+  return HOCICorrection(W, W0, Z, R, betaType, overlaps, C);
+}
 
 double bsg::SpectralFunctions::RelativisticCorrection(double W, double W0, int Z,
                                                  int A, double R, int betaType,
@@ -546,55 +658,59 @@ double bsg::SpectralFunctions::RecoilCorrection(double W, double W0, int A,
            1. / (1 + 1. / std::pow(mixingRatio, 2)) *
                (Ar0 + Ar1 / W + Ar2 * W + Ar3 * W * W);
   }
-  cout << "Mixing ratio badly defined. Returning 1." << endl;
+  // not on standard output, which carries the spectrum with --stdout
+  std::cerr << "Mixing ratio badly defined. Returning 1." << endl;
   return 1;
 }
 
 double bsg::SpectralFunctions::AtomicScreeningCorrection(double W, int Z,
                                                     int betaType) {
-  std::vector<double> Aby, Bby;
+  return AtomicScreeningCorrection(W, CalculateScreeningContext(Z, betaType));
+}
+
+bsg::SpectralFunctions::ScreeningContext
+bsg::SpectralFunctions::CalculateScreeningContext(int Z, int betaType) {
+  double Aby[3] = {0., 0., 0.};
+  double Bby[3] = {0., 0., 0.};
 
   screening::PotParam(Z - 1 * betaType, Aby, Bby);
 
-  double l = 2 * (Aby[0] * Bby[0] + Aby[1] * Bby[1] + Aby[2] * Bby[2]);
+  ScreeningContext c;
+  c.l = 2 * (Aby[0] * Bby[0] + Aby[1] * Bby[1] + Aby[2] * Bby[2]);
+  c.WtShift = betaType * 0.5 * ALPHA * (Z - betaType) * c.l;
+  c.eta = betaType * ALPHA * Z;
+  c.gamma = std::sqrt(1. - pow(ALPHA * Z, 2.));
+  return c;
+}
+
+double bsg::SpectralFunctions::AtomicScreeningCorrection(
+    double W, const ScreeningContext& c) {
+  double l = c.l;
 
   double p = std::sqrt(W * W - 1);
 
-  double Wt = W - betaType * 0.5 * ALPHA * (Z - betaType) * l;
+  double Wt = W - c.WtShift;
 
   std::complex<double> pt;
 
   pt = 0.5 * p +
        0.5 * std::sqrt(std::complex<double>(p * p -
-                                            betaType * 2 * ALPHA * Z * Wt * l));
+                                            2 * c.eta * Wt * l));
 
-  double y = betaType * ALPHA * Z * W / p;
-  std::complex<double> yt = betaType * ALPHA * Z * Wt / pt;
+  double y = c.eta * W / p;
+  std::complex<double> yt = c.eta * Wt / pt;
 
-  double gamma = std::sqrt(1. - pow(ALPHA * Z, 2.));
-
-  /*cout << "V: " << W-Wt << endl;
-  cout << W << " " << yt.real() << " " << yt.imag() << endl;
-  cout << W << " " << pt.real() << " " << pt.imag() << endl;*/
-
-  gsl_sf_result magn;
-  gsl_sf_result phase;
-  gsl_sf_lngamma_complex_e(gamma, y, &magn, &phase);
-
-  gsl_sf_result magnT;
-  gsl_sf_result phaseT;
-  gsl_sf_lngamma_complex_e(gamma - yt.imag(), yt.real(), &magnT, &phaseT);
-  // now we have what we wAt in magn.val
+  double magn = LnGammaMagnitude(c.gamma, y);
+  double magnT = LnGammaMagnitudeAnyX(c.gamma - yt.imag(), yt.real());
 
   double first = Wt / W;
-  double second = std::exp(2 * (magnT.val - magn.val));
+  double second = std::exp(2 * (magnT - magn));
 
-  gsl_sf_lngamma_complex_e(gamma - 2 * pt.imag() / l, 2 * pt.real() / l, &magnT,
-                           &phaseT);
-  gsl_sf_lngamma_complex_e(1, 2 * p / l, &magn, &phase);
-  double third = std::exp(2 * (magnT.val - magn.val));
+  magnT = LnGammaMagnitudeAnyX(c.gamma - 2 * pt.imag() / l, 2 * pt.real() / l);
+  magn = LnGammaMagnitude(1, 2 * p / l);
+  double third = std::exp(2 * (magnT - magn));
   double fourth = std::exp(-M_PI * y);
-  double fifth = std::pow(2 * p / l, 2 * (1 - gamma));
+  double fifth = std::pow(2 * p / l, 2 * (1 - c.gamma));
 
   return first * second * third * fourth * fifth;
 }
@@ -631,3 +747,284 @@ double bsg::SpectralFunctions::AtomicMismatchCorrection(double W, double W0, int
 
   return 1 - 2 / (W0 - W) * (0.5 * dBdZ2 + 2 * (C0 + C1));
 }
+
+void bsg::SpectralFunctions::PhaseSpace(const double W[], double result[],
+                                        int size, double W0,
+                                        int motherSpinParity,
+                                        int daughterSpinParity) {
+  for (int i = 0; i < size; i++) {
+    result[i] = std::sqrt(W[i] * W[i] - 1.) * W[i] * (W0 - W[i]) * (W0 - W[i]);
+  }
+}
+
+void bsg::SpectralFunctions::FermiFunction(const double W[], double result[],
+                                           int size, int Z, double R,
+                                           int betaType) {
+  double gamma = std::sqrt(1. - std::pow(ALPHA * Z, 2.));
+  double first = 2. * (gamma + 1.);
+  double lnGamma2 = gsl_sf_lngamma(2. * gamma + 1.);
+  double eta = betaType * ALPHA * Z;
+
+  for (int i = 0; i < size; i++) {
+    double p = std::sqrt(W[i] * W[i] - 1.);
+    double third = std::pow(2. * p * R, 2. * (gamma - 1.));
+    double fourth = std::exp(M_PI * eta * W[i] / p);
+    double magn = LnGammaMagnitude(gamma, eta * W[i] / p);
+    double fifth = std::exp(2. * (magn - lnGamma2));
+    result[i] = first * third * fourth * fifth;
+  }
+}
+
+void bsg::SpectralFunctions::CCorrection(
+    const double W[], double result[], int size,
+    const CCorrectionCoefficients& c, bool addCI) {
+  double w = 0.;
+  double Ap = 0.;
+  if (addCI) {
+    UniformCIParameters(c.Z, c.betaType, w, Ap);
+  }
+  for (int i = 0; i < size; i++) {
+    double cShape, cNS;
+    std::tie(cShape, cNS) = CCorrectionComponents(W[i], c);
+    result[i] = addCI ? cShape * UniformCICorrection(W[i], c.W0, c.Z, c.R, c.betaType, w, Ap) + cNS
+                      : cShape + cNS;
+  }
+}
+
+void bsg::SpectralFunctions::CCorrection(
+    const double W[], double result[], int size,
+    const CCorrectionCoefficients& c, bool addCI,
+    nme::NuclearStructure::SingleParticleState& spsi,
+    nme::NuclearStructure::SingleParticleState& spsf) {
+  double C = 0.;
+  std::vector<HOOverlap> overlaps;
+  if (addCI) {
+    overlaps = CalculateHOOverlaps(c.Z, c.R, spsi, spsf, C);
+  }
+  for (int i = 0; i < size; i++) {
+    double cShape, cNS;
+    std::tie(cShape, cNS) = CCorrectionComponents(W[i], c);
+    result[i] = addCI ? cShape * HOCICorrection(W[i], c.W0, c.Z, c.R, c.betaType, overlaps, C) + cNS
+                      : cShape + cNS;
+  }
+}
+
+void bsg::SpectralFunctions::L0Correction(const double W[], double result[],
+                                          int size, int Z, double r,
+                                          int betaType, double aPos[],
+                                          double aNeg[]) {
+  double gamma = std::sqrt(1. - std::pow(ALPHA * Z, 2.));
+  double* a = (betaType == BETA_PLUS) ? aPos : aNeg;
+  double c0 = 1. + 13. / 60. * std::pow(ALPHA * Z, 2) +
+              (betaType == BETA_PLUS ? 0.22 : 0.41) * (r - 0.0164) *
+                  std::pow(ALPHA * Z, 4.5);
+  double c1 = -betaType * r * ALPHA * Z * (41. - 26. * gamma) / 15. /
+              (2. * gamma - 1);
+  double cm1 = -betaType * ALPHA * Z * r * gamma * (17. - 2. * gamma) / 30. /
+               (2. * gamma - 1) + a[0] * r;
+  double norm = 2. / (1. + gamma);
+
+  for (int i = 0; i < size; i++) {
+    double x = W[i] * r;
+    double sum = a[1] + x * (a[2] + x * (a[3] + x * (a[4] + x * (a[5] + x * a[6]))));
+    result[i] = (c0 + c1 * W[i] + cm1 / W[i] + sum) * norm;
+  }
+}
+
+void bsg::SpectralFunctions::UCorrection(const double W[], double result[],
+                                         int size, int Z, double R,
+                                         int betaType, std::string ESShape,
+                                         std::vector<double>& v,
+                                         std::vector<double>& vp) {
+  double delta1 = 4. / 3. * (vp[0] - v[0]) + 17. / 30. * (vp[1] - v[1]) +
+                  25. / 63. * (vp[2] - v[2]);
+  double delta2 = 2. / 3. * (vp[0] - v[0]) + 7. / 12. * (vp[1] - v[1]) +
+                  11. / 6. * (vp[2] - v[2]);
+  double delta3 = 1. / 3. * (vp[0] * vp[0] - v[0] * v[0]) +
+                  1. / 15. * (vp[1] * vp[1] - v[1] * v[1]) +
+                  1. / 35. * (vp[2] * vp[2] - v[2] * v[2]) +
+                  1. / 6. * (vp[1] * vp[0] - v[1] * v[0]) +
+                  1. / 9. * (vp[2] * vp[0] - v[2] * v[0]) +
+                  1. / 20. * (vp[2] * vp[1] - v[2] * v[1]) +
+                  1. / 5. * (vp[1] - v[1]) + 1. / 7. * (vp[2] - v[2]);
+  double delta4 = 4. / 3. * (vp[0] - v[0]) + 4. / 5. * (vp[1] - v[1]) +
+                  4. / 7. * (vp[2] - v[2]);
+
+  double gamma = std::sqrt(1. - (ALPHA * Z) * (ALPHA * Z));
+
+  double u0 = 1. + (ALPHA * Z) * (ALPHA * Z) * delta3;
+  double u1 = betaType * ALPHA * Z * R * delta1;
+  double um1 = betaType * gamma * ALPHA * Z * R * delta2;
+  double u2 = -R * R * delta4;
+
+  bool fermiShape = (ESShape == "Fermi");
+  double a0 = -5.6E-5 - betaType * 4.94E-5 * Z + 6.23E-8 * std::pow(Z, 2);
+  double a1 = 5.17E-6 + betaType * 2.517E-6 * Z + 2.00E-8 * std::pow(Z, 2);
+  double a2 = -9.17e-8 + betaType * 5.53E-9 * Z + 1.25E-10 * std::pow(Z, 2);
+
+  for (int i = 0; i < size; i++) {
+    double shape = 1.;
+    if (fermiShape) {
+      double p = std::sqrt(W[i] * W[i] - 1);
+      shape = 1. + a0 + a1 * p + a2 * p * p;
+    }
+    result[i] = shape * (u0 + u1 * W[i] + um1 / W[i] + u2 * W[i] * W[i]);
+  }
+}
+
+void bsg::SpectralFunctions::QCorrection(const double W[], double result[],
+                                         int size, double W0, int Z, int A,
+                                         int betaType, int decayType,
+                                         double mixingRatio) {
+  double a = 0;
+
+  if (decayType == FERMI)
+    a = 1.;
+  else if (decayType == GAMOW_TELLER)
+    a = -1. / 3.;
+  else if (mixingRatio > 0.)
+    a = (1. - std::pow(mixingRatio, 2.) / 3.) / (1. + std::pow(mixingRatio, 2));
+
+  double M = A * (PROTON_MASS_KEV + NEUTRON_MASS_KEV) / 2. / ELECTRON_MASS_KEV;
+  double prefactor = betaType * M_PI * ALPHA * Z / M;
+  double slope = a / 3. / M;
+
+  for (int i = 0; i < size; i++) {
+    double p = std::sqrt(W[i] * W[i] - 1.);
+    result[i] = 1. - prefactor / p * (1. + slope * (W0 - W[i]));
+  }
+}
+
+void bsg::SpectralFunctions::RadiativeCorrection(const double W[],
+                                                 double result[], int size,
+                                                 double W0, int Z, double R,
+                                                 int betaType, double gA,
+                                                 double gM) {
+  double logMass = std::log(PROTON_MASS_KEV / ELECTRON_MASS_KEV);
+  double g0 = 3. * logMass - 0.75 -
+              3. * std::log(PROTON_MASS_KEV / ELECTRON_MASS_KEV / 2. / W0);
+
+  double L =
+      1.026725 * std::pow(1. - 2. * ALPHA / 3. / M_PI * std::log(2. * W0), 9. / 4.);
+
+  double lambda = std::sqrt(10) / R;
+  double lambdaOverM = lambda / NUCLEON_MASS_KEV * ELECTRON_MASS_KEV;
+
+  double d1f = std::log(lambdaOverM) - EULER_MASCHERONI_CONSTANT + 4. / 3. -
+               std::log(std::sqrt(10.0)) -
+               3.0 / M_PI / std::sqrt(10.0) * lambdaOverM *
+                   (0.5 + EULER_MASCHERONI_CONSTANT +
+                    std::log(std::sqrt(10) / lambdaOverM));
+
+  double d2 = 3.0 / 2.0 / M_PI / std::sqrt(10.0) * lambdaOverM *
+              (1. - M_PI / 2. / std::sqrt(10) * lambdaOverM);
+
+  double d3 = 3.0 * gA * gM / M_PI / std::sqrt(10.0) * lambdaOverM *
+              (EULER_MASCHERONI_CONSTANT - 1. +
+               std::log(std::sqrt(10) / lambdaOverM) +
+               M_PI / 4 / std::sqrt(10) * lambdaOverM);
+
+  double O2const = ALPHA * ALPHA * Z;
+  double d2const = logMass + 43. / 18. + d1f + d2 + d3;
+
+  double a = 0.5697;
+  double b =
+      4. / 3. / M_PI * (11. / 4. - EULER_MASCHERONI_CONSTANT - M_PI * M_PI / 6);
+  double O3const = std::pow(ALPHA, 3) * std::pow(Z, 2);
+  double logR = std::log(R);
+  double O3end = 0.649 * std::log(2 * W0);
+
+  for (int i = 0; i < size; i++) {
+    double w = W[i];
+    double beta = std::sqrt(1.0 - 1.0 / w / w);
+    double atanhBeta = std::atanh(beta);
+    double log2W = std::log(2 * w);
+
+    // 1st order, based on the 5th Wilkinson article
+    double g = g0 +
+               4. * (atanhBeta / beta - 1.) *
+                   ((W0 - w) / 3. / w - 1.5 + std::log(2 * (W0 - w))) +
+               4.0 / beta * Spence(2. * beta / (1. + beta)) +
+               atanhBeta / beta *
+                   (2. * (1. + beta * beta) + (W0 - w) * (W0 - w) / 6. / w / w -
+                    4. * atanhBeta);
+    double O1corr = ALPHA / 2. / M_PI * g;
+
+    // 2nd order
+    double O2corr = O2const * (d2const - 5. / 3. * log2W);
+
+    // 3rd order
+    double f = log2W - 5. / 6.;
+    double g2 = 0.5 * (logR * logR - log2W * log2W) +
+                5. / 3. * std::log(2 * R * w);
+    double O3corr = O3const * (a * std::log(lambda / w) + b * f +
+                               4. / M_PI / 3. * g2 - O3end);
+
+    result[i] = (1 + O1corr) * (L + O2corr + O3corr);
+  }
+}
+
+void bsg::SpectralFunctions::NeutrinoRadiativeCorrection(const double Wv[],
+                                                         double result[],
+                                                         int size) {
+  double h0 = 3 * std::log(PROTON_MASS_KEV / ELECTRON_MASS_KEV) + 23 / 4.;
+  for (int i = 0; i < size; i++) {
+    double pv = std::sqrt(Wv[i] * Wv[i] - 1);
+    double beta = pv / Wv[i];
+    double atanBeta = std::atan(beta);
+    double h = h0 + 8 / beta * Spence(2 * beta / (1 + beta)) +
+               8 * (atanBeta / beta - 1) * std::log(2 * Wv[i] * beta) +
+               4 * atanBeta / beta * ((7 + 3 * beta * beta) / 8 - 2 * atanBeta);
+    result[i] = 1 + ALPHA / 2 / M_PI * h;
+  }
+}
+
+void bsg::SpectralFunctions::RecoilCorrection(const double W[],
+                                              double result[], int size,
+                                              double W0, int A, int decayType,
+                                              double mixingRatio) {
+  double M = A * (PROTON_MASS_KEV + NEUTRON_MASS_KEV) / 2. /
+             ELECTRON_MASS_KEV;  // in units of electron mass
+  double M2 = sqr(M);
+
+  double Ar0 = -2. * W0 / 3. / M - W0 * W0 / 6. / M2 - 77. / 18. / M2;
+  double Ar1 = -2. / 3. / M + 7. * W0 / 9. / M2;
+  double Ar2 = 10. / 3. / M - 28. * W0 / 9. / M2;
+  double Ar3 = 88. / 9. / M2;
+
+  double Vr0 = W0 * W0 / 2. / M2 - 11. / 6. / M2;
+  double Vr1 = W0 / 3. / M2;
+  double Vr2 = 2. / M - 4. * W0 / 3. / M2;
+  double Vr3 = 16. / 3. / M2;
+
+  // combine the vector and axial parts into a single polynomial
+  double fV = 0., fA = 0.;
+  if (decayType == FERMI) {
+    fV = 1.;
+  } else if (decayType == GAMOW_TELLER) {
+    fA = 1.;
+  } else if (mixingRatio > 0) {
+    fV = 1. / (1 + std::pow(mixingRatio, 2));
+    fA = 1. / (1 + 1. / std::pow(mixingRatio, 2));
+  } else {
+    // not on standard output, which carries the spectrum with --stdout
+    std::cerr << "Mixing ratio badly defined. Returning 1." << endl;
+  }
+  double c0 = 1 + fV * Vr0 + fA * Ar0;
+  double cm1 = fV * Vr1 + fA * Ar1;
+  double c1 = fV * Vr2 + fA * Ar2;
+  double c2 = fV * Vr3 + fA * Ar3;
+
+  for (int i = 0; i < size; i++) {
+    result[i] = c0 + cm1 / W[i] + c1 * W[i] + c2 * W[i] * W[i];
+  }
+}
+
+void bsg::SpectralFunctions::AtomicExchangeCorrection(const double W[],
+                                                      double result[],
+                                                      int size,
+                                                      double exPars[9]) {
+  for (int i = 0; i < size; i++) {
+    result[i] = AtomicExchangeCorrection(W[i], exPars);
+  }
+}
@@ -0,0 +1,79 @@
+#include "SpectrumFile.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bsg::SpectrumFile::SpectrumFile() : data(nullptr), length(0), header(nullptr) {}
+
+bsg::SpectrumFile::SpectrumFile(std::string fileName)
+    : data(nullptr), length(0), header(nullptr) {
+  Open(fileName);
+}
+
+bsg::SpectrumFile::~SpectrumFile() { Close(); }
+
+bool bsg::SpectrumFile::Open(std::string fileName) {
+  Close();
+  error.clear();
+
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if (fd < 0) {
+    error = "cannot open " + fileName;
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (std::size_t)st.st_size < sizeof(SpectrumFileHeader)) {
+    error = fileName + " is too short for a spectrum file";
+    close(fd);
+    return false;
+  }
+  void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  // the mapping stays valid after closing the descriptor
+  close(fd);
+  if (map == MAP_FAILED) {
+    error = "cannot map " + fileName;
+    return false;
+  }
+  data = static_cast<const char*>(map);
+  length = st.st_size;
+  header = reinterpret_cast<const SpectrumFileHeader*>(data);
+
+  if (std::memcmp(header->magic, SPECTRUM_FILE_MAGIC, sizeof(SPECTRUM_FILE_MAGIC)) != 0) {
+    error = fileName + " is not a BSG spectrum file";
+  } else if (header->version != SPECTRUM_FILE_VERSION) {
+    error = fileName + " has unsupported version " + std::to_string(header->version);
+  } else if (header->byteOrder != SPECTRUM_FILE_BYTE_ORDER) {
+    error = fileName + " was written on a machine with a different byte order";
+  } else if (header->nColumns != 3 || header->dataOffset % sizeof(double) != 0 ||
+             header->dataOffset > length ||
+             // divided rather than multiplied, so that a corrupt nPoints cannot overflow
+             header->nPoints > (length - header->dataOffset) / (header->nColumns * sizeof(double))) {
+    error = fileName + " is truncated or corrupt";
+  }
+  if (!error.empty()) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void bsg::SpectrumFile::Close() {
+  if (data) {
+    munmap(const_cast<char*>(data), length);
+  }
+  data = nullptr;
+  length = 0;
+  header = nullptr;
+}
+
+std::pair<std::size_t, std::size_t> bsg::SpectrumFile::FindRange(double beginW, double endW) const {
+  const double* W = GetW();
+  const double* first = std::lower_bound(W, W + Size(), beginW);
+  const double* last = std::upper_bound(first, W + Size(), endW);
+  return std::make_pair(first - W, last - W);
+}
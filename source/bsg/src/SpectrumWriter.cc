@@ -0,0 +1,252 @@
+#include "SpectrumWriter.h"
+#include "Constants.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+
+bsg::BufferedFileWriter::BufferedFileWriter(std::string _fileName, bool append,
+                                            std::size_t _blockSize)
+    : fileName(_fileName), owned(true), blockSize(_blockSize), closing(false) {
+  file = std::fopen(fileName.c_str(), append ? "ab" : "wb");
+  current.reserve(blockSize);
+  if (file) {
+    worker = std::thread(&BufferedFileWriter::Run, this);
+  } else {
+    error = fmt::format("cannot open {}: {}", fileName, std::strerror(errno));
+  }
+}
+
+bsg::BufferedFileWriter::BufferedFileWriter(std::FILE* stream, std::size_t _blockSize)
+    : file(stream), fileName("the output stream"), owned(false), blockSize(_blockSize), closing(false) {
+  current.reserve(blockSize);
+  if (file) {
+    worker = std::thread(&BufferedFileWriter::Run, this);
+  }
+}
+
+bsg::BufferedFileWriter::~BufferedFileWriter() { Close(); }
+
+void bsg::BufferedFileWriter::Write(const char* data, std::size_t size) {
+  if (!file) return;
+  current.append(data, size);
+  if (current.size() >= blockSize) {
+    Submit(-1, current);
+    current.reserve(blockSize);
+  }
+}
+
+void bsg::BufferedFileWriter::WriteAt(std::uint64_t offset, std::string&& block) {
+  if (!file) return;
+  // keep the order with respect to data written at the current position
+  if (!current.empty()) {
+    Submit(-1, current);
+  }
+  Submit(offset, block);
+}
+
+void bsg::BufferedFileWriter::Flush() {
+  if (file && !current.empty()) {
+    Submit(-1, current);
+  }
+}
+
+void bsg::BufferedFileWriter::Submit(std::int64_t offset, std::string& data) {
+  std::unique_lock<std::mutex> lock(mutex);
+  // limit the memory held by blocks that are not yet written
+  condition.wait(lock, [this] { return pending.size() < 4; });
+  pending.push_back(Block());
+  pending.back().offset = offset;
+  pending.back().data.swap(data);
+  condition.notify_all();
+}
+
+void bsg::BufferedFileWriter::Run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    condition.wait(lock, [this] { return closing || !pending.empty(); });
+    if (pending.empty()) break;
+    Block block;
+    block.offset = pending.front().offset;
+    block.data.swap(pending.front().data);
+    pending.pop_front();
+    condition.notify_all();
+
+    // after an error, the remaining blocks are discarded
+    if (!error.empty()) continue;
+    lock.unlock();
+    bool written = block.offset < 0 || fseeko(file, block.offset, SEEK_SET) == 0;
+    written = written && std::fwrite(block.data.data(), 1, block.data.size(), file) == block.data.size();
+    // make every block available to readers of a pipe right away
+    written = written && std::fflush(file) == 0;
+    std::string problem = written ? "" : fmt::format("cannot write to {}: {}", fileName, std::strerror(errno));
+    lock.lock();
+    if (!written) {
+      error = problem;
+    }
+  }
+}
+
+bool bsg::BufferedFileWriter::Close() {
+  if (!file) return error.empty();
+  if (!current.empty()) {
+    Submit(-1, current);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    closing = true;
+  }
+  condition.notify_all();
+  worker.join();
+  if (owned && std::fclose(file) != 0 && error.empty()) {
+    error = fmt::format("cannot write to {}: {}", fileName, std::strerror(errno));
+  }
+  file = nullptr;
+  return error.empty();
+}
+
+bsg::TextSpectrumWriter::TextSpectrumWriter(std::string fileName, bool neutrino,
+                                            bool append)
+    : output(fileName, append), writeNeutrino(neutrino) {}
+
+void bsg::TextSpectrumWriter::Push(double W, double electron, double neutrino) {
+  line.clear();
+  if (writeNeutrino) {
+    fmt::format_to(std::back_inserter(line), "{:<10f}\t{:<10f}\t{:<10f}\t{:<10f}\n", W, (W-1.)*ELECTRON_MASS_KEV, electron, neutrino);
+  } else {
+    fmt::format_to(std::back_inserter(line), "{:<10f}\t{:<10f}\t{:<10f}\n", W, (W-1.)*ELECTRON_MASS_KEV, electron);
+  }
+  output.Write(line.data(), line.size());
+}
+
+bsg::BinarySpectrumWriter::BinarySpectrumWriter(std::string fileName,
+                                                const SpectrumFileHeader& _header)
+    : output(fileName, false), header(_header), blockStart(0), count(0) {
+  std::memcpy(header.magic, SPECTRUM_FILE_MAGIC, sizeof(SPECTRUM_FILE_MAGIC));
+  header.version = SPECTRUM_FILE_VERSION;
+  header.byteOrder = SPECTRUM_FILE_BYTE_ORDER;
+  header.nColumns = 3;
+  header.dataOffset = SPECTRUM_FILE_DATA_OFFSET;
+  std::memset(header.columnNames, 0, sizeof(header.columnNames));
+  std::strcpy(header.columnNames[0], "W");
+  std::strcpy(header.columnNames[1], "electron");
+  std::strcpy(header.columnNames[2], "neutrino");
+
+  std::string block(SPECTRUM_FILE_DATA_OFFSET, '\0');
+  std::memcpy(&block[0], &header, sizeof(header));
+  output.WriteAt(0, std::move(block));
+}
+
+bsg::BinarySpectrumWriter::~BinarySpectrumWriter() { Close(); }
+
+void bsg::BinarySpectrumWriter::Push(double W, double electron, double neutrino) {
+  if (count >= header.nPoints) return;
+  double values[] = {W, electron, neutrino};
+  for (int c = 0; c < 3; c++) {
+    columns[c].append(reinterpret_cast<const char*>(&values[c]), sizeof(double));
+  }
+  count++;
+  if (columns[0].size() >= (1 << 18)) {
+    WriteColumns();
+  }
+}
+
+void bsg::BinarySpectrumWriter::WriteColumns() {
+  std::uint64_t n = columns[0].size() / sizeof(double);
+  for (int c = 0; c < 3; c++) {
+    std::uint64_t offset = header.dataOffset + (c * header.nPoints + blockStart) * sizeof(double);
+    output.WriteAt(offset, std::move(columns[c]));
+    columns[c].clear();
+  }
+  blockStart += n;
+}
+
+bool bsg::BinarySpectrumWriter::Close() {
+  if (output.IsOpen() && !columns[0].empty()) {
+    WriteColumns();
+  }
+  return output.Close();
+}
+
+bsg::StreamSpectrumWriter::StreamSpectrumWriter(std::FILE* stream, bool _binary,
+                                                const SpectrumFileHeader& _header,
+                                                std::size_t _chunkSize)
+    : output(stream), binary(_binary), chunkSize(_chunkSize), count(0), closed(false) {
+  SpectrumFileHeader header = _header;
+  std::memcpy(header.magic, SPECTRUM_STREAM_MAGIC, sizeof(SPECTRUM_STREAM_MAGIC));
+  header.version = SPECTRUM_FILE_VERSION;
+  header.byteOrder = SPECTRUM_FILE_BYTE_ORDER;
+  header.nColumns = 3;
+  header.dataOffset = SPECTRUM_FILE_DATA_OFFSET;
+  std::memset(header.columnNames, 0, sizeof(header.columnNames));
+  std::strcpy(header.columnNames[0], "W");
+  std::strcpy(header.columnNames[1], "electron");
+  std::strcpy(header.columnNames[2], "neutrino");
+
+  if (binary) {
+    std::string block(SPECTRUM_FILE_DATA_OFFSET, '\0');
+    std::memcpy(&block[0], &header, sizeof(header));
+    output.Write(block.data(), block.size());
+  } else {
+    fmt::memory_buffer text;
+    fmt::format_to(std::back_inserter(text), "# BSG spectrum stream version {}\n", header.version);
+    fmt::format_to(std::back_inserter(text), "# Z {} A {} W0 {} QValue {} optionsHash {:016x}\n",
+                   header.Z, header.A, header.W0, header.QValue, header.optionsHash);
+    fmt::format_to(std::back_inserter(text), "# points {}\n", header.nPoints);
+    fmt::format_to(std::back_inserter(text), "# columns W E electron neutrino\n");
+    output.Write(text.data(), text.size());
+  }
+  output.Flush();
+  for (int c = 0; c < 3; c++) columns[c].reserve(chunkSize);
+}
+
+bsg::StreamSpectrumWriter::~StreamSpectrumWriter() { Close(); }
+
+void bsg::StreamSpectrumWriter::Push(double W, double electron, double neutrino) {
+  columns[0].push_back(W);
+  columns[1].push_back(electron);
+  columns[2].push_back(neutrino);
+  count++;
+  if (columns[0].size() >= chunkSize) {
+    WriteFrame();
+  }
+}
+
+void bsg::StreamSpectrumWriter::WriteFrame() {
+  std::size_t n = columns[0].size();
+  if (binary) {
+    std::uint32_t size = n;
+    output.Write("CHNK", 4);
+    output.Write(reinterpret_cast<const char*>(&size), sizeof(size));
+    for (int c = 0; c < 3; c++) {
+      output.Write(reinterpret_cast<const char*>(columns[c].data()), n * sizeof(double));
+    }
+  } else {
+    fmt::memory_buffer text;
+    fmt::format_to(std::back_inserter(text), "# chunk {}\n", n);
+    for (std::size_t i = 0; i < n; i++) {
+      double W = columns[0][i];
+      fmt::format_to(std::back_inserter(text), "{:<10f}\t{:<10f}\t{:<10f}\t{:<10f}\n", W, (W-1.)*ELECTRON_MASS_KEV, columns[1][i], columns[2][i]);
+    }
+    output.Write(text.data(), text.size());
+  }
+  output.Flush();
+  for (int c = 0; c < 3; c++) columns[c].clear();
+}
+
+bool bsg::StreamSpectrumWriter::Close() {
+  if (closed) return output.Close();
+  closed = true;
+  if (!columns[0].empty()) {
+    WriteFrame();
+  }
+  if (binary) {
+    std::uint32_t total = count;
+    output.Write("DONE", 4);
+    output.Write(reinterpret_cast<const char*>(&total), sizeof(total));
+  } else {
+    std::string end = fmt::format("# end {}\n", count);
+    output.Write(end.data(), end.size());
+  }
+  return output.Close();
+}
@@ -1,5 +1,9 @@
 #include "Utilities.h"
 
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
 bsg::utilities::Lagrange::Lagrange(double* x, double* y) {
   xC[0] = x[0];
   xC[1] = x[1];
@@ -19,3 +23,165 @@ double bsg::utilities::Lagrange::GetValue(double x) {
 
   return first + second + third;
 }
+
+bsg::utilities::MonotoneSpline::MonotoneSpline(const std::vector<double>& x,
+                                               const std::vector<double>& y)
+    : xC(x), yC(y), dC(x.size(), 0.) {
+  std::size_t n = xC.size();
+  std::vector<double> h(n - 1), delta(n - 1);
+  for (std::size_t i = 0; i < n - 1; i++) {
+    h[i] = xC[i + 1] - xC[i];
+    delta[i] = (yC[i + 1] - yC[i]) / h[i];
+  }
+  if (n == 2) {
+    dC[0] = dC[1] = delta[0];
+    return;
+  }
+  // interior points: weighted harmonic mean of the neighbouring slopes
+  for (std::size_t i = 1; i < n - 1; i++) {
+    if (delta[i - 1] * delta[i] > 0.) {
+      double w1 = 2. * h[i] + h[i - 1];
+      double w2 = h[i] + 2. * h[i - 1];
+      dC[i] = (w1 + w2) / (w1 / delta[i - 1] + w2 / delta[i]);
+    }
+  }
+  // end points: three-point formula, limited to preserve monotonicity
+  for (int e = 0; e < 2; e++) {
+    std::size_t i = e == 0 ? 0 : n - 1;
+    std::size_t k = e == 0 ? 0 : n - 2;
+    std::size_t j = e == 0 ? 1 : n - 3;
+    double d = ((2. * h[k] + h[j]) * delta[k] - h[k] * delta[j]) / (h[k] + h[j]);
+    if (d * delta[k] <= 0.) {
+      d = 0.;
+    } else if (delta[k] * delta[j] <= 0. && std::abs(d) > std::abs(3. * delta[k])) {
+      d = 3. * delta[k];
+    }
+    dC[i] = d;
+  }
+}
+
+double bsg::utilities::MonotoneSpline::GetValue(double x) const {
+  std::size_t i = std::upper_bound(xC.begin(), xC.end(), x) - xC.begin();
+  i = std::min(std::max(i, (std::size_t)1), xC.size() - 1) - 1;
+
+  double h = xC[i + 1] - xC[i];
+  double t = (x - xC[i]) / h;
+  double t2 = t * t;
+  double t3 = t2 * t;
+
+  return (2. * t3 - 3. * t2 + 1.) * yC[i] + (t3 - 2. * t2 + t) * h * dC[i] +
+         (-2. * t3 + 3. * t2) * yC[i + 1] + (t3 - t2) * h * dC[i + 1];
+}
+
+bsg::utilities::MonotoneSpline bsg::utilities::AdaptiveMonotoneSpline(
+    std::function<double(double)> f, double a, double b, double tolerance,
+    int maxNodes, double& errorEstimate) {
+  const int initialIntervals = 16;
+
+  std::vector<double> x, y;
+  for (int i = 0; i <= initialIntervals; i++) {
+    x.push_back(a + (b - a) * i / initialIntervals);
+    y.push_back(f(x.back()));
+  }
+  // exact values at the midpoints of the intervals [x[i], x[i+1]], each evaluated only once
+  std::vector<double> midY(initialIntervals);
+  std::vector<bool> evaluated(initialIntervals, false);
+
+  MonotoneSpline spline(x, y);
+  while (true) {
+    // refining an interval changes the slopes at its ends, so every midpoint
+    // is checked again against the current spline
+    std::vector<bool> refine(x.size() - 1, false);
+    bool refined = false;
+    errorEstimate = 0.;
+    for (std::size_t i = 0; i < x.size() - 1; i++) {
+      double mid = 0.5 * (x[i] + x[i + 1]);
+      if (!evaluated[i]) {
+        midY[i] = f(mid);
+        evaluated[i] = true;
+      }
+      double error = std::abs(spline.GetValue(mid) - midY[i]) /
+                     std::max(std::abs(midY[i]), 1e-300);
+      errorEstimate = std::max(errorEstimate, error);
+      refine[i] = error > tolerance;
+      refined = refined || refine[i];
+    }
+    // stop refining when the number of nodes could exceed maxNodes
+    if (!refined || (int)(2 * x.size() - 1) > maxNodes) break;
+
+    std::vector<double> newX, newY, newMidY;
+    std::vector<bool> newEvaluated;
+    for (std::size_t i = 0; i < x.size(); i++) {
+      newX.push_back(x[i]);
+      newY.push_back(y[i]);
+      if (i == x.size() - 1) break;
+      if (refine[i]) {
+        newX.push_back(0.5 * (x[i] + x[i + 1]));
+        newY.push_back(midY[i]);
+        newMidY.insert(newMidY.end(), 2, 0.);
+        newEvaluated.insert(newEvaluated.end(), 2, false);
+      } else {
+        newMidY.push_back(midY[i]);
+        newEvaluated.push_back(true);
+      }
+    }
+    x.swap(newX);
+    y.swap(newY);
+    midY.swap(newMidY);
+    evaluated.swap(newEvaluated);
+    spline = MonotoneSpline(x, y);
+  }
+  return spline;
+}
+
+void bsg::utilities::GaussLegendre(int n, std::vector<double>& nodes,
+                                   std::vector<double>& weights) {
+  nodes.assign(n, 0.);
+  weights.assign(n, 0.);
+  // Legendre polynomial P_n and its derivative from the three-term recurrence
+  auto legendre = [n](double x, double& dp) {
+    double p0 = 1., p1 = x;
+    for (int k = 2; k <= n; k++) {
+      double p2 = ((2. * k - 1.) * x * p1 - (k - 1.) * p0) / k;
+      p0 = p1;
+      p1 = p2;
+    }
+    dp = n * (x * p1 - p0) / (x * x - 1.);
+    return p1;
+  };
+  // the nodes are symmetric, so only the positive ones are found by Newton iteration
+  for (int i = 0; i < (n + 1) / 2; i++) {
+    double x = std::cos(M_PI * (i + 0.75) / (n + 0.5));
+    double dp;
+    for (int iteration = 0; iteration < 100; iteration++) {
+      double dx = legendre(x, dp) / dp;
+      x -= dx;
+      if (std::abs(dx) < 1e-15) break;
+    }
+    legendre(x, dp);
+    double w = 2. / ((1. - x * x) * dp * dp);
+    nodes[i] = -x;
+    nodes[n - 1 - i] = x;
+    weights[i] = w;
+    weights[n - 1 - i] = w;
+  }
+}
+
+bool bsg::utilities::ReadValues(std::string fileName, std::vector<double>& values) {
+  std::ifstream file(fileName.c_str());
+  if (!file.is_open()) return false;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    std::istringstream stream(line);
+    double x;
+    while (stream >> x) values.push_back(x);
+    if (!stream.eof()) return false;
+  }
+  return true;
+}
+
+std::mutex& bsg::utilities::GetRootMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
@@ -0,0 +1,162 @@
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Checkpoint.h"
+#include "Spectrum.h"
+#include "SpectrumSink.h"
+
+#include <unistd.h>
+
+namespace {
+const char* fileName = "checkpoint_check.ckpt";
+int failures = 0;
+
+void Check(bool condition, const std::string& what) {
+  if (!condition) {
+    std::printf("FAILED: %s\n", what.c_str());
+    failures++;
+  }
+}
+
+/**
+ * Points i = begin, ..., end - 1 of a made-up spectrum
+ */
+void MakePoints(std::size_t begin, std::size_t end, std::vector<double>& W, std::vector<double>& electron,
+                std::vector<double>& neutrino) {
+  W.clear();
+  electron.clear();
+  neutrino.clear();
+  for (std::size_t i = begin; i < end; i++) {
+    W.push_back(1. + 0.1 * i);
+    electron.push_back(1. / (i + 1.));
+    neutrino.push_back(i * i + 0.5);
+  }
+}
+
+/**
+ * Whether a resumed spectrum holds points 0, ..., n - 1 of MakePoints
+ */
+bool HasPoints(const bsg::Spectrum& spectrum, std::size_t n) {
+  std::vector<double> W, electron, neutrino;
+  MakePoints(0, n, W, electron, neutrino);
+  return spectrum.GetW() == W && spectrum.GetElectron() == electron && spectrum.GetNeutrino() == neutrino;
+}
+
+/**
+ * Append points begin, ..., end - 1 and accumulate their moments
+ */
+bool AppendPoints(bsg::Checkpoint& checkpoint, bsg::SpectrumMoments& moments, std::size_t begin, std::size_t end) {
+  std::vector<double> W, electron, neutrino;
+  MakePoints(begin, end, W, electron, neutrino);
+  for (std::size_t i = 0; i < W.size(); i++) moments.Push(W[i], electron[i], neutrino[i]);
+  return checkpoint.Append(W.data(), electron.data(), neutrino.data(), W.size());
+}
+
+bool SameMoments(const bsg::SpectrumMoments::State& a, const bsg::SpectrumMoments& b) {
+  bsg::SpectrumMoments m;
+  m.SetState(a);
+  for (int k = 0; k < bsg::SpectrumMoments::N_MOMENTS; k++) {
+    if (m.GetMoment(k) != b.GetMoment(k)) return false;
+  }
+  return true;
+}
+
+/**
+ * Flip a byte of the file
+ */
+void Corrupt(long offset) {
+  std::FILE* f = std::fopen(fileName, "r+b");
+  std::fseek(f, offset, SEEK_SET);
+  int c = std::fgetc(f);
+  std::fseek(f, offset, SEEK_SET);
+  std::fputc(c ^ 0xff, f);
+  std::fclose(f);
+}
+}
+
+/**
+ * Round trip of bsg::Checkpoint: points only count once committed, a
+ * resumed checkpoint continues where it left off, a torn header falls back
+ * to the other slot, and a checkpoint of other options, another grid or
+ * with missing points is refused.
+ */
+int main() {
+  const std::uint64_t hash = 0x1234abcd;
+  const std::uint64_t nTotal = 10;
+  bsg::SpectrumMoments moments;
+  bsg::SpectrumMoments::State committed;
+  {
+    bsg::Checkpoint checkpoint(fileName);
+    Check(checkpoint.Create(hash, nTotal), "create: " + checkpoint.GetError());
+    Check(AppendPoints(checkpoint, moments, 0, 4), "append");
+    committed = moments.GetState();
+    Check(checkpoint.Commit(committed), "commit: " + checkpoint.GetError());
+    // not committed, as if the process was killed here
+    bsg::SpectrumMoments discarded;
+    discarded.SetState(committed);
+    Check(AppendPoints(checkpoint, discarded, 4, 7), "append");
+  }
+
+  bsg::Spectrum prefix;
+  bsg::SpectrumMoments::State state;
+  {
+    bsg::Checkpoint checkpoint(fileName);
+    Check(checkpoint.Resume(hash, nTotal, prefix, state), "resume: " + checkpoint.GetError());
+    Check(checkpoint.GetDone() == 4 && HasPoints(prefix, 4), "resume restores the committed points only");
+    Check(SameMoments(state, moments), "resume restores the committed moments");
+
+    moments.SetState(state);
+    Check(AppendPoints(checkpoint, moments, 4, 10), "append after resume");
+    Check(checkpoint.Commit(moments.GetState()), "commit after resume: " + checkpoint.GetError());
+  }
+  {
+    bsg::Checkpoint checkpoint(fileName);
+    Check(checkpoint.Resume(hash, nTotal, prefix, state), "second resume: " + checkpoint.GetError());
+    Check(checkpoint.GetDone() == 10 && HasPoints(prefix, 10), "uncommitted points are overwritten after resume");
+    Check(SameMoments(state, moments), "second resume restores the moments");
+
+    Check(!checkpoint.Resume(hash + 1, nTotal, prefix, state) &&
+              checkpoint.GetError().find("different options") != std::string::npos,
+          "a checkpoint of other options is refused");
+    Check(!checkpoint.Resume(hash, nTotal + 1, prefix, state) &&
+              checkpoint.GetError().find("different energy grid") != std::string::npos,
+          "a checkpoint of another grid is refused");
+  }
+
+  // Create wrote sequence 0 to slot 0 and the commits 1 and 2 went to slots 1 and 0,
+  // so a torn write of the newest header falls back to the first commit
+  Corrupt(offsetof(bsg::CheckpointHeader, nDone));
+  {
+    bsg::Checkpoint checkpoint(fileName);
+    Check(checkpoint.Resume(hash, nTotal, prefix, state), "resume with a torn header: " + checkpoint.GetError());
+    Check(checkpoint.GetDone() == 4 && HasPoints(prefix, 4), "a torn header falls back to the other slot");
+  }
+  Corrupt(bsg::CHECKPOINT_SLOT_SIZE + offsetof(bsg::CheckpointHeader, sequence));
+  {
+    bsg::Checkpoint checkpoint(fileName);
+    Check(!checkpoint.Resume(hash, nTotal, prefix, state) &&
+              checkpoint.GetError().find("not a valid") != std::string::npos,
+          "a checkpoint without a valid header is refused");
+  }
+
+  {
+    bsg::Checkpoint checkpoint(fileName);
+    Check(checkpoint.Create(hash, nTotal), "create: " + checkpoint.GetError());
+    bsg::SpectrumMoments m;
+    Check(AppendPoints(checkpoint, m, 0, 5), "append");
+    Check(checkpoint.Commit(m.GetState()), "commit: " + checkpoint.GetError());
+  }
+  Check(truncate(fileName, bsg::CHECKPOINT_DATA_OFFSET + 2 * 3 * sizeof(double)) == 0, "truncate");
+  {
+    bsg::Checkpoint checkpoint(fileName);
+    Check(!checkpoint.Resume(hash, nTotal, prefix, state) &&
+              checkpoint.GetError().find("truncated") != std::string::npos,
+          "a truncated checkpoint is refused");
+    checkpoint.Remove();
+  }
+
+  if (failures == 0) std::printf("Checkpoint round trip passed\n");
+  return failures == 0 ? 0 : 1;
+}
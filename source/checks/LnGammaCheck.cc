@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+
+#include "Constants.h"
+#include "Screening.h"
+#include "Utilities.h"
+
+#include "gsl/gsl_sf_gamma.h"
+
+namespace {
+const double tolerance = 1e-12;
+
+/**
+ * Largest difference with GSL relative to max(1, |ln|Gamma||), see
+ * utilities::LnGammaComplexMagnitude, and where it occurs
+ */
+struct Difference {
+  double value = 0.;
+  double x = 0.;
+  double y = 0.;
+  int count = 0;
+
+  void Add(double _x, double _y) {
+    gsl_sf_result lnr, arg;
+    gsl_sf_lngamma_complex_e(_x, _y, &lnr, &arg);
+    double d = std::abs(bsg::utilities::LnGammaComplexMagnitude(_x, _y) - lnr.val) / std::max(1., std::abs(lnr.val));
+    count++;
+    if (d > value) {
+      value = d;
+      x = _x;
+      y = _y;
+    }
+  }
+
+  bool Report(const char* name) const {
+    std::printf("%s: largest relative difference with GSL in %d arguments %.3e at x = %g, y = %g\n", name, count,
+                value, x, y);
+    if (value > tolerance) {
+      std::printf("FAILED: above the tolerance of %.1e\n", tolerance);
+      return false;
+    }
+    return true;
+  }
+};
+}
+
+/**
+ * Compare utilities::LnGammaComplexMagnitude with gsl_sf_lngamma_complex_e
+ * for Z up to 120 and kinetic energies from 0.1 keV to 20 MeV, over
+ *  - the arguments of the Fermi function, i.e. real parts between
+ *    gamma = sqrt(1 - (alpha Z)^2) and 2 and imaginary parts up to alpha Z W/p,
+ *  - the four arguments of SpectralFunctions::AtomicScreeningCorrection for
+ *    beta- and beta+ decay, as far as their real part is positive; the others
+ *    are passed to GSL by the correction.
+ * Fails when the difference exceeds the tolerance anywhere.
+ */
+int main() {
+  const int nX = 20;
+  const int nE = 400;
+
+  Difference fermi;
+  Difference screening;
+  for (int Z = 1; Z <= 120; Z++) {
+    double gamma = std::sqrt(1. - std::pow(bsg::ALPHA * Z, 2.));
+    for (int j = 0; j <= nE; j++) {
+      double E = 0.1 * std::pow(2e5, (double)j / nE);
+      double W = 1. + E / bsg::ELECTRON_MASS_KEV;
+      double p = std::sqrt(W * W - 1.);
+      for (int sign = -1; sign <= 1; sign += 2) {
+        for (int i = 0; i <= nX; i++) {
+          fermi.Add(gamma + (2. - gamma) * i / nX, sign * bsg::ALPHA * Z * W / p);
+        }
+
+        // as in SpectralFunctions::CalculateScreeningContext and AtomicScreeningCorrection
+        double Aby[3] = {0., 0., 0.};
+        double Bby[3] = {0., 0., 0.};
+        bsg::screening::PotParam(Z - sign, Aby, Bby);
+        double l = 2 * (Aby[0] * Bby[0] + Aby[1] * Bby[1] + Aby[2] * Bby[2]);
+        if (!(l > 0.)) continue;
+        double eta = sign * bsg::ALPHA * Z;
+        double Wt = W - sign * 0.5 * bsg::ALPHA * (Z - sign) * l;
+        std::complex<double> pt = 0.5 * p + 0.5 * std::sqrt(std::complex<double>(p * p - 2 * eta * Wt * l));
+        std::complex<double> yt = eta * Wt / pt;
+        double arguments[4][2] = {{gamma, eta * W / p},
+                                  {gamma - yt.imag(), yt.real()},
+                                  {gamma - 2 * pt.imag() / l, 2 * pt.real() / l},
+                                  {1., 2 * p / l}};
+        for (const auto& a : arguments) {
+          if (a[0] > 0.) screening.Add(a[0], a[1]);
+        }
+      }
+    }
+  }
+
+  bool passed = fermi.Report("Fermi function");
+  passed = screening.Report("Screening correction") && passed;
+  return passed ? 0 : 1;
+}
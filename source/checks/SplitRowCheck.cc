@@ -0,0 +1,76 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Batch.h"
+
+namespace {
+int failures = 0;
+
+std::string Show(const std::vector<std::string>& cells) {
+  std::string text;
+  for (const auto& c : cells) text += "[" + c + "]";
+  return text;
+}
+
+void Check(const std::string& line, char delimiter, const std::vector<std::string>& expected) {
+  std::vector<std::string> cells;
+  bool complete = bsg::SplitRow(line, delimiter, cells);
+  if (!complete || cells != expected) {
+    std::printf("FAILED: %s gives %s instead of %s\n", line.c_str(), complete ? Show(cells).c_str() : "an error",
+                Show(expected).c_str());
+    failures++;
+  }
+}
+
+void CheckUnclosed(const std::string& line) {
+  std::vector<std::string> cells;
+  if (bsg::SplitRow(line, ',', cells)) {
+    std::printf("FAILED: unclosed quote in %s is accepted\n", line.c_str());
+    failures++;
+  }
+}
+
+/**
+ * Quote every cell as a CSV writer would
+ */
+std::string Join(const std::vector<std::string>& cells, char delimiter) {
+  std::string line;
+  for (std::size_t i = 0; i < cells.size(); i++) {
+    if (i > 0) line += delimiter;
+    line += '"';
+    for (char c : cells[i]) line += c == '"' ? std::string("\"\"") : std::string(1, c);
+    line += '"';
+  }
+  return line;
+}
+}
+
+/**
+ * Cases of bsg::SplitRow, the parser of the rows of batch tables: trimming,
+ * empty cells, quoted delimiters and escaped quotes, and a round trip of
+ * cells quoted by a CSV writer
+ */
+int main() {
+  Check("a,b,c", ',', {"a", "b", "c"});
+  Check(" a , b\t,c ", ',', {"a", "b", "c"});
+  Check("a,,b", ',', {"a", "", "b"});
+  Check("a,", ',', {"a", ""});
+  Check("", ',', {""});
+  Check("\"x, y\",z", ',', {"x, y", "z"});
+  Check("\"say \"\"hi\"\"\",2", ',', {"say \"hi\"", "2"});
+  Check("\"\"\"\"", ',', {"\""});
+  Check("  \"q\"  ,r", ',', {"q", "r"});
+  Check("\" padded \",x", ',', {" padded ", "x"});
+  Check("a\t b \t\"c\td\"", '\t', {"a", "b", "c\td"});
+  CheckUnclosed("\"abc,d");
+  CheckUnclosed("a,\"b\"\"");
+
+  for (char delimiter : {',', '\t'}) {
+    std::vector<std::string> cells = {"plain", "with,comma", "with\ttab", "with \"quotes\"", " padded ", "", "\"\""};
+    Check(Join(cells, delimiter), delimiter, cells);
+  }
+
+  if (failures == 0) std::printf("SplitRow checks passed\n");
+  return failures == 0 ? 0 : 1;
+}
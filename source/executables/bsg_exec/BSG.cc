@@ -1,17 +1,57 @@
+#include "Batch.h"
 #include "Generator.h"
 #include "BSGOptionContainer.h"
+#include "ResultCache.h"
+#include "spdlog/spdlog.h"
 #include <iostream>
 #include <chrono>
 #include <string>
+#include <vector>
 
 int main(int argc, char** argv) {
   bsg::BSGOptionContainer::GetInstance(argc, argv);
 
-  if (BSGOptExists(input)) {
-    bsg::Generator* gen = new bsg::Generator();
-    gen->CalculateSpectrum();
-    delete gen;
+  int status = 0;
+  if (BSGOptExists(batch) || BSGOptExists(table)) {
+    bsg::BatchRunner batch(argc, argv, bsg::BSGOptionContainer::GetInstance());
+    bool ready = BSGOptExists(batch) ? batch.ReadManifest(GetBSGOpt(std::string, batch))
+                                     : batch.OpenTable(GetBSGOpt(std::string, table));
+    if (!ready) {
+      spdlog::error(batch.GetError());
+      status = 1;
+    } else {
+      int failed = batch.Run(GetBSGOpt(int, jobs), GetBSGOpt(std::string, output));
+      if (!batch.GetError().empty()) spdlog::error(batch.GetError());
+      spdlog::info("{} of {} calculations failed, see {}.batch", failed, batch.GetNumberOfJobs(),
+                   GetBSGOpt(std::string, output));
+      status = failed > 0 ? 1 : 0;
+    }
+  } else if (BSGOptExists(input)) {
+    bsg::BSGOptions options = bsg::BSGOptionContainer::GetInstance().GetOptions();
+    bsg::ResultCache cache = bsg::ResultCache::FromOptions(options);
+    std::string key = cache.IsEnabled() ? bsg::ResultCache::GetKey(options) : "";
+    std::string output = options.Get<std::string>("output");
+    if (cache.IsEnabled()) {
+      spdlog::info("Using the result cache in {} of at most {} MB (disable with --no-cache)", cache.GetDirectory(),
+                   cache.GetMaxBytes() / (1024 * 1024));
+    }
+    if (!cache.Fetch(key, output)) {
+      bsg::Generator* gen = new bsg::Generator(options);
+      gen->CalculateSpectrum();
+      bool written = gen->GetOutputError().empty();
+      std::vector<std::string> files = gen->GetOutputFiles();
+      // closes the output files
+      delete gen;
+      if (written) {
+        cache.Store(key, output, files);
+      } else {
+        status = 1;
+      }
+    }
   }
 
-  return 0;
+  // write what the background logging thread still holds
+  spdlog::shutdown();
+
+  return status;
 }
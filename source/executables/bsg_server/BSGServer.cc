@@ -0,0 +1,62 @@
+#include "Server.h"
+#include "BSGOptionContainer.h"
+#include "spdlog/spdlog.h"
+#include <atomic>
+#include <csignal>
+#include <iostream>
+#include <string>
+
+namespace po = boost::program_options;
+
+namespace {
+std::atomic<bool> stop(false);
+
+void Stop(int) { stop = true; }
+}
+
+int main(int argc, char** argv) {
+  po::options_description serverOptions("Server options");
+  serverOptions.add_options()(
+      "socket", po::value<std::string>()->default_value("bsg.sock"),
+      "Set the path of the Unix domain socket on which requests are accepted.")(
+      "workers", po::value<int>()->default_value(0),
+      "Set the number of requests calculated at the same time. Use 0 to match "
+      "the number of available cores. With more than one, one worker only "
+      "takes interactive requests.")(
+      "work-dir", po::value<std::string>()->default_value("."),
+      "Set the directory for the output files of the calculations.")(
+      "keep-output", "Keep the output files of the calculations.");
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(serverOptions).allow_unregistered().run(), vm);
+  po::notify(vm);
+  if (vm.count("help")) {
+    std::cout << serverOptions << std::endl;
+  }
+
+  // the transition is given by every request, the other options apply to all of them
+  bsg::OptionValues none;
+  bsg::BSGOptionContainer container(argc, argv, &none);
+  if (container.Exists("help") || container.Exists("version")) {
+    return 0;
+  }
+
+  std::signal(SIGINT, Stop);
+  std::signal(SIGTERM, Stop);
+
+  int status = 0;
+  bsg::SpectrumServer server(argc, argv, container, vm["work-dir"].as<std::string>(), vm["workers"].as<int>(),
+                             vm.count("keep-output") > 0);
+  if (!server.Listen(vm["socket"].as<std::string>())) {
+    spdlog::error(server.GetError());
+    status = 1;
+  } else {
+    spdlog::info("Listening on {}", vm["socket"].as<std::string>());
+    server.Serve(stop);
+    spdlog::info("Stopped");
+  }
+
+  // write what the background logging thread still holds
+  spdlog::shutdown();
+
+  return status;
+}
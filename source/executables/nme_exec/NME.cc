@@ -27,5 +27,8 @@ int main(int argc, char** argv) {
     }
   }
 
+  // write what the background logging thread still holds
+  spdlog::shutdown();
+
   return 0;
 }
@@ -8,6 +8,8 @@
 #include <boost/program_options/parsers.hpp>
 #include <boost/program_options/variables_map.hpp>
 
+#include "NMEOptions.h"
+
 namespace po = boost::program_options;
 
 /**
@@ -26,10 +28,21 @@ namespace po = boost::program_options;
 
 namespace nme {
 
+/**
+ * Turn option values into parsed options, as if they were read from a
+ * configuration file. Names unknown to the description are marked as
+ * unregistered and are skipped when stored.
+ *
+ * @param values option names and values
+ * @param description the options to look the names up in
+ */
+po::parsed_options ParseOptionValues(const OptionValues& values, const po::options_description& description);
+
 /**
  * Class that combines all options from commandline, configuration files and
  * environment variables.
- * Implemented as a Singleton
+ * The instance used by the NME executable is a singleton, but other instances
+ * can be created to parse the options of additional calculations.
  */
 class NMEOptionContainer {
  public:
@@ -40,6 +53,14 @@ class NMEOptionContainer {
     static NMEOptionContainer instance(argc, argv);
     return instance;
   }
+
+  /**
+   * Parse the options from the command line and the configuration and input files it names
+   *
+   * @param values option values to use instead of the input file. They take
+   * precedence over the configuration file, but not over the command line.
+   */
+  NMEOptionContainer(int, char**, const OptionValues* values = NULL);
   /**
    * Get the option from the container
    *
@@ -64,6 +85,12 @@ class NMEOptionContainer {
   void ParseCmdLineOptions(int, char**);
   void ParseConfigOptions(std::string);
   void ParseInputOptions(std::string);
+  void ParseValues(const OptionValues&);
+  /**
+   * Snapshot of the options, to be passed to the objects of a calculation
+   */
+  inline NMEOptions GetOptions() const { return NMEOptions(vm); };
+
   /**
    * Check whether an options was given
    *
@@ -91,7 +118,6 @@ class NMEOptionContainer {
   po::options_description configOptions;
   po::options_description envOptions;
   po::options_description transitionOptions;
-  NMEOptionContainer(int, char**);
   NMEOptionContainer(NMEOptionContainer const& copy);
   NMEOptionContainer& operator=(NMEOptionContainer const& copy);
 };
@@ -0,0 +1,79 @@
+#ifndef NME_OPTIONS
+#define NME_OPTIONS
+
+#include <iostream>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/program_options/variables_map.hpp>
+
+namespace nme {
+
+/**
+ * Option names and values given directly instead of through an input file,
+ * e.g. a row of a batch table. Vector options take whitespace separated values.
+ */
+typedef std::vector<std::pair<std::string, std::string> > OptionValues;
+
+/**
+ * Immutable set of the resolved options of a single calculation.
+ * Copies share the same values, so that they are cheap to hand to every
+ * object taking part in the calculation and can be read from several
+ * threads at once.
+ */
+class NMEOptions {
+ public:
+  /**
+   * Empty set of options
+   */
+  NMEOptions() : vm(std::make_shared<boost::program_options::variables_map>()){};
+
+  /**
+   * @param _vm the parsed options, which are copied
+   */
+  NMEOptions(const boost::program_options::variables_map& _vm)
+      : vm(std::make_shared<boost::program_options::variables_map>(_vm)){};
+
+  /**
+   * Get the value of an option
+   *
+   * @template T variable type
+   * @param name variable name
+   */
+  template <typename T>
+  T Get(std::string name) const {
+    try {
+      return (*vm)[name].as<T>();
+    } catch (boost::bad_any_cast& e) {
+      std::cerr << "NME ERROR: Option \"" << name << "\" not defined. " << std::endl;
+      throw e;
+    }
+  }
+
+  /**
+   * Check whether an option was given
+   *
+   * @param name variable name
+   */
+  inline bool Exists(std::string name) const { return vm->count(name) > 0; };
+
+  inline const boost::program_options::variables_map& GetVariablesMap() const { return *vm; };
+
+  /**
+   * Options that determine the nuclear structure calculation
+   *
+   * @param exclude names of options to leave out, e.g. those controlling the output
+   * @returns one name=value line per option, ordered by name
+   */
+  std::string GetOptionsString(const std::set<std::string>& exclude) const;
+
+ private:
+  std::shared_ptr<const boost::program_options::variables_map> vm;
+};
+
+}
+
+#endif
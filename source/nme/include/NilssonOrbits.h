@@ -4,6 +4,7 @@
 #include "Utilities.h"
 #include "Constants.h"
 #include "NuclearUtilities.h"
+#include "Logging.h"
 #include "spdlog/spdlog.h"
 
 #include <iostream>
@@ -149,8 +150,9 @@ inline double VNORM(int n, int l) {
  *Woods-Saxon potential
  */
 inline void WoodsSaxon(double V0, double R, double A0, double V0S, double A,
-                       double Z, int nMax, double SW[2][84], double SDW[462]) {
-  auto dbl = spdlog::get("debug_file");
+                       double Z, int nMax, double SW[2][84], double SDW[462],
+                       const bsg::logging::Loggers& loggers) {
+  auto dbl = loggers.debug;
   dbl->debug("Entered WoodsSaxon");
   double FINT[3] = {};
   double S[3][4] = {};
@@ -276,8 +278,8 @@ inline void WoodsSaxon(double V0, double R, double A0, double V0S, double A,
  * @param onlyUpper boolean to say whether only the upper part was given
  */
 inline void Eigen(double* A, int dim, double* eVecs, std::vector<double>& eVals,
-                  bool onlyUpper = true) {
-  auto dbl = spdlog::get("debug_file");
+                  const bsg::logging::Loggers& loggers, bool onlyUpper = true) {
+  auto dbl = loggers.debug;
   dbl->debug("Entered Eigen");
   gsl_matrix* aNew = gsl_matrix_alloc(dim, dim);
   // Loop over upper half of matrix
@@ -351,8 +353,9 @@ inline void Eigen(double* A, int dim, double* eVecs, std::vector<double>& eVals,
  */
 inline std::vector<SingleParticleState> Calculate(
     double spin, double beta2, double beta4, double beta6, double V0, double R,
-    double A0, double V0S, double A, double Z, int nMax) {
-  auto dbl = spdlog::get("debug_file");
+    double A0, double V0S, double A, double Z, int nMax,
+    const bsg::logging::Loggers& loggers) {
+  auto dbl = loggers.debug;
   dbl->debug("Entered Calculate");
   double SW[2][84] = {};
   double SDW[462] = {};
@@ -383,7 +386,7 @@ inline std::vector<SingleParticleState> Calculate(
 
   std::vector<SingleParticleState> states;
 
-  WoodsSaxon(V0, R, A0, V0S, A, Z, nMax, SW, SDW);
+  WoodsSaxon(V0, R, A0, V0S, A, Z, nMax, SW, SDW, loggers);
 
   dbl->debug("Past WoodsSaxon");
 
@@ -431,7 +434,7 @@ inline std::vector<SingleParticleState> Calculate(
       }
     }
     std::vector<double> eVals;
-    Eigen(hamM, II - NIM, eVecs, eVals);
+    Eigen(hamM, II - NIM, eVecs, eVals, loggers);
 
     int index = 0.0;
     for (int i = NI; i <= II; i++) {
@@ -467,8 +470,7 @@ inline std::vector<SingleParticleState> Calculate(
     }
   }
   if (K == 0) {
-    spdlog::get("console")
-        ->warn("No harmonic oscillator single particle states below 10 MeV.");
+    loggers.console->warn("No harmonic oscillator single particle states below 10 MeV.");
     return states;
   }
 
@@ -610,7 +612,7 @@ inline std::vector<SingleParticleState> Calculate(
           hamM[NK - 1] += eValsWS[N0 - 1];
         }
         std::vector<double> eVals;
-        Eigen(hamM, KKK, eVecs, eVals);
+        Eigen(hamM, KKK, eVecs, eVals, loggers);
         int N0 = 0;
         for (int MU = 1; MU <= KKK; MU++) {
           N0 += MU;
@@ -748,11 +750,12 @@ inline bool StateSorter(SingleParticleState const& lhs,
  */
 inline std::vector<SingleParticleState> GetAllSingleParticleStates(
     int Z, int N, int A, int dJ, double R, double beta2, double beta4,
-    double beta6, double V0, double A0, double VS) {
+    double beta6, double V0, double A0, double VS,
+    const bsg::logging::Loggers& loggers) {
   std::vector<SingleParticleState> evenStates =
-      Calculate(6.5, beta2, beta4, beta6, V0, R, A0, VS, A, Z, 12);
+      Calculate(6.5, beta2, beta4, beta6, V0, R, A0, VS, A, Z, 12, loggers);
   std::vector<SingleParticleState> oddStates =
-      Calculate(6.5, beta2, beta4, beta6, V0, R, A0, VS, A, Z, 13);
+      Calculate(6.5, beta2, beta4, beta6, V0, R, A0, VS, A, Z, 13, loggers);
 
   // Join all states
   std::vector<SingleParticleState> allStates;
@@ -794,9 +797,10 @@ inline SingleParticleState CalculateDeformedSPState(int Z, int N, int A, int dJ,
                                                     double beta4, double beta6,
                                                     double V0, double A0,
                                                     double VS, int dJreq,
-                                                    double threshold) {
+                                                    double threshold,
+                                                    const bsg::logging::Loggers& loggers) {
   std::vector<SingleParticleState> allStates = GetAllSingleParticleStates(
-      Z, N, A, dJ, R, beta2, beta4, beta6, V0, A0, VS);
+      Z, N, A, dJ, R, beta2, beta4, beta6, V0, A0, VS, loggers);
 
   int index = 0;
   if (beta2 == 0 && beta4 == 0 && beta6 == 0) {
@@ -811,7 +815,7 @@ inline SingleParticleState CalculateDeformedSPState(int Z, int N, int A, int dJ,
     index = (Z + N - 1) / 2;
     if (threshold > 0) {
       double refEnergy = allStates[index].energy;
-      spdlog::get("nme_results_file")->info("Estimated reference state: {}/2 ({} MeV)", allStates[index].parity * allStates[index].dO,
+      loggers.results->info("Estimated reference state: {}/2 ({} MeV)", allStates[index].parity * allStates[index].dO,
       allStates[index].energy);
       index = 0;
       for (int i = 0; i < allStates.size(); i++) {
@@ -825,12 +829,12 @@ inline SingleParticleState CalculateDeformedSPState(int Z, int N, int A, int dJ,
       }
       if (index == 0) {
         index = (Z + N - 1) / 2;
-        spdlog::get("console")->warn(
+        loggers.console->warn(
             "WARNING: Couldn't find a correct spin state within the threshold.");
       }
     }
   }
-  auto nmeResults = spdlog::get("nme_results_file");
+  auto nmeResults = loggers.results;
   nmeResults->info("Sorted single particle states\n{:->30}", "");
 
   for (int i = 0; i < allStates.size(); i++) {
@@ -6,6 +6,7 @@
 #include <map>
 
 #include "NuclearUtilities.h"
+#include "NMEOptions.h"
 #include "spdlog/spdlog.h"
 
 namespace nme {
@@ -22,6 +23,15 @@ class NuclearStructureManager {
    * Constructor
    */
   NuclearStructureManager();
+  /**
+   * Constructor using a given set of options instead of those of the
+   * NMEOptionContainer singleton, so that several managers can be used side by side
+   *
+   * @param options the options of the calculation
+   * @param debugFileLogger logger for debugging information, created from the options when nullptr
+   */
+  NuclearStructureManager(const NMEOptions& options,
+                          std::shared_ptr<spdlog::logger> debugFileLogger = nullptr);
   /**
    * Overloaded constructor
    *
@@ -121,6 +131,8 @@ class NuclearStructureManager {
 
   std::string outputName;
 
+  NMEOptions options;
+
   std::shared_ptr<spdlog::logger> consoleLogger;
   std::shared_ptr<spdlog::logger> debugFileLogger;
   std::shared_ptr<spdlog::logger> nmeResultsLogger;
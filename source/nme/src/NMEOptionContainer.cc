@@ -1,5 +1,6 @@
 #include "NMEOptionContainer.h"
 #include <iostream>
+#include <sstream>
 
 #include "spdlog/spdlog.h"
 
@@ -14,7 +15,7 @@ po::options_description nme::NMEOptionContainer::transitionOptions("Transition i
 po::options_description nme::NMEOptionContainer::envOptions("Environment options");
 po::variables_map nme::NMEOptionContainer::vm;*/
 
-nme::NMEOptionContainer::NMEOptionContainer(int argc, char** argv) {
+nme::NMEOptionContainer::NMEOptionContainer(int argc, char** argv, const OptionValues* values) {
   transitionOptions.add_options()("Transition.Process",
                                   po::value<std::string>(),
                                   "Set the decay process: B+, B-")(
@@ -122,6 +123,10 @@ nme::NMEOptionContainer::NMEOptionContainer(int argc, char** argv) {
       "inducedtensor,d", "Calculate the induced tensor form factor d/Ac")(
       "matrixelement,M", po::value<std::string>(),
       "Calculate the matrix element ^XM_{yyy} written as Xyyy")(
+      "log-level", po::value<std::string>()->default_value("info"),
+      "Set the lowest level written to the log file: trace, debug, info, "
+      "warning, error, critical or off.")(
+      "no-log-files", "Do not create the log file.")(
       "version", "Show the current version");
 
   ParseCmdLineOptions(argc, argv);
@@ -146,6 +151,11 @@ nme::NMEOptionContainer::NMEOptionContainer(int argc, char** argv) {
     cout << "\n\n**************************************************************"
             "*\n\n" << endl;
     cout << configOptions << endl;
+  } else if (values) {
+    // stored first, so that they take precedence over the configuration file,
+    // which is optional here
+    ParseValues(*values);
+    if (!configName.empty()) ParseConfigOptions(configName);
   } else {
     ParseConfigOptions(configName);
     ParseInputOptions(inputName);
@@ -199,3 +209,30 @@ void nme::NMEOptionContainer::ParseInputOptions(std::string inputName) {
   po::notify(vm);
   spdlog::debug("NME:In parseInputOptions end");
 }
+
+void nme::NMEOptionContainer::ParseValues(const OptionValues& values) {
+  po::options_description valueOptions;
+  valueOptions.add(transitionOptions).add(configOptions);
+  po::store(ParseOptionValues(values, valueOptions), vm);
+  po::notify(vm);
+}
+
+po::parsed_options nme::ParseOptionValues(const OptionValues& values, const po::options_description& description) {
+  po::parsed_options parsed(&description);
+  for (const auto& v : values) {
+    po::option option;
+    option.string_key = v.first;
+    const po::option_description* known = description.find_nothrow(v.first, false);
+    option.unregistered = !known;
+    if (known && known->semantic()->max_tokens() > 1) {
+      std::istringstream tokens(v.second);
+      std::string token;
+      while (tokens >> token) option.value.push_back(token);
+    } else {
+      option.value.push_back(v.second);
+    }
+    option.original_tokens = {v.first, v.second};
+    parsed.options.push_back(option);
+  }
+  return parsed;
+}
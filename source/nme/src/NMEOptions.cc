@@ -0,0 +1,23 @@
+#include "NMEOptions.h"
+
+#include <sstream>
+#include <vector>
+
+std::string nme::NMEOptions::GetOptionsString(const std::set<std::string>& exclude) const {
+  std::ostringstream dump;
+  dump.precision(17);
+  for (const auto& option : *vm) {
+    if (exclude.count(option.first)) continue;
+    const boost::any& value = option.second.value();
+    dump << option.first << "=";
+    if (const double* d = boost::any_cast<double>(&value)) dump << *d;
+    else if (const int* i = boost::any_cast<int>(&value)) dump << *i;
+    else if (const bool* b = boost::any_cast<bool>(&value)) dump << *b;
+    else if (const std::string* str = boost::any_cast<std::string>(&value)) dump << *str;
+    else if (const std::vector<double>* v = boost::any_cast<std::vector<double> >(&value)) {
+      for (double x : *v) dump << x << ",";
+    }
+    dump << "\n";
+  }
+  return dump.str();
+}
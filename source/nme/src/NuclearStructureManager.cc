@@ -4,6 +4,7 @@
 #include "MatrixElements.h"
 #include "NuclearUtilities.h"
 #include "ChargeDistributions.h"
+#include "Logging.h"
 
 #include "spdlog/sinks/basic_file_sink.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
@@ -27,9 +28,8 @@ namespace utilities = bsg::utilities;
 using std::cout;
 using std::endl;
 
-void ShowNMEInfo() {
+void ShowNMEInfo(std::shared_ptr<spdlog::logger> logger) {
   std::string author = "L. Hayen (leendert.hayen@kuleuven.be)";
-  auto logger = spdlog::get("nme_results_file");
   logger->info("{:*>60}", "");
   logger->info("{:^60}", "NME v" + std::string(NME_VERSION));
   logger->info("{:^60}", "Last update: " + std::string(NME_LAST_UPDATE));
@@ -37,7 +37,12 @@ void ShowNMEInfo() {
   logger->info("{:*>60}\n", "");
 }
 
-NS::NuclearStructureManager::NuclearStructureManager() {
+NS::NuclearStructureManager::NuclearStructureManager()
+    : NuclearStructureManager(NMEOptionContainer::GetInstance().GetOptions()) {}
+
+NS::NuclearStructureManager::NuclearStructureManager(const NMEOptions& _options,
+                                                     std::shared_ptr<spdlog::logger> _debugFileLogger)
+    : options(_options), debugFileLogger(_debugFileLogger) {
   InitializeLoggers();
   InitializeConstants();
 }
@@ -53,19 +58,19 @@ NS::NuclearStructureManager::NuclearStructureManager(BetaType bt,
 
 void NS::NuclearStructureManager::InitializeConstants() {
   debugFileLogger->debug("Entered InitializeConstants");
-  int Zd = GetNMEOpt(int, Daughter.Z);
-  int Zm = GetNMEOpt(int, Mother.Z);
-  int Ad = GetNMEOpt(int, Daughter.A);
-  int Am = GetNMEOpt(int, Mother.A);
+  int Zd = options.Get<int>("Daughter.Z");
+  int Zm = options.Get<int>("Mother.Z");
+  int Ad = options.Get<int>("Daughter.A");
+  int Am = options.Get<int>("Mother.A");
 
   if (Ad != Am) {
     consoleLogger->error(
         "ERROR: Mother and daughter mass number do not agree.");
     return;
   }
-  double Rd = GetNMEOpt(double, Daughter.Radius) * 1e-15 / bsg::NATURAL_LENGTH *
+  double Rd = options.Get<double>("Daughter.Radius") * 1e-15 / bsg::NATURAL_LENGTH *
               std::sqrt(5. / 3.);
-  double Rm = GetNMEOpt(double, Mother.Radius) * 1e-15 / bsg::NATURAL_LENGTH *
+  double Rm = options.Get<double>("Mother.Radius") * 1e-15 / bsg::NATURAL_LENGTH *
               std::sqrt(5. / 3.);
   if (Rd == 0.0) {
     Rd = 1.2 * std::pow(Ad, 1. / 3.) * 1e-15 / bsg::NATURAL_LENGTH;
@@ -73,19 +78,19 @@ void NS::NuclearStructureManager::InitializeConstants() {
   if (Rm == 0.0) {
     Rm = 1.2 * std::pow(Am, 1. / 3.) * 1e-15 / bsg::NATURAL_LENGTH;
   }
-  double motherBeta2 = GetNMEOpt(double, Mother.Beta2);
-  double motherBeta4 = GetNMEOpt(double, Mother.Beta4);
-  double motherBeta6 = GetNMEOpt(double, Mother.Beta6);
-  double daughterBeta2 = GetNMEOpt(double, Daughter.Beta2);
-  double daughterBeta4 = GetNMEOpt(double, Daughter.Beta4);
-  double daughterBeta6 = GetNMEOpt(double, Daughter.Beta6);
-  int motherSpinParity = GetNMEOpt(int, Mother.SpinParity);
-  int daughterSpinParity = GetNMEOpt(int, Daughter.SpinParity);
+  double motherBeta2 = options.Get<double>("Mother.Beta2");
+  double motherBeta4 = options.Get<double>("Mother.Beta4");
+  double motherBeta6 = options.Get<double>("Mother.Beta6");
+  double daughterBeta2 = options.Get<double>("Daughter.Beta2");
+  double daughterBeta4 = options.Get<double>("Daughter.Beta4");
+  double daughterBeta6 = options.Get<double>("Daughter.Beta6");
+  int motherSpinParity = options.Get<int>("Mother.SpinParity");
+  int daughterSpinParity = options.Get<int>("Daughter.SpinParity");
 
-  double motherExcitationEn = GetNMEOpt(double, Mother.ExcitationEnergy);
-  double daughterExcitationEn = GetNMEOpt(double, Daughter.ExcitationEnergy);
+  double motherExcitationEn = options.Get<double>("Mother.ExcitationEnergy");
+  double daughterExcitationEn = options.Get<double>("Daughter.ExcitationEnergy");
 
-  std::string process = GetNMEOpt(std::string, Transition.Process);
+  std::string process = options.Get<std::string>("Transition.Process");
 
   if (boost::iequals(process, "B+")) {
     betaType = BETA_PLUS;
@@ -106,11 +111,11 @@ void NS::NuclearStructureManager::InitializeConstants() {
   SetDaughterNucleus(Zd, Ad, daughterSpinParity, Rm, daughterExcitationEn,
                      daughterBeta2, daughterBeta4, daughterBeta6);
 
-  potential = GetNMEOpt(std::string, Computational.Potential);
+  potential = options.Get<std::string>("Computational.Potential");
 
   nmeResultsLogger->info("NME input overview\n{:=>30}", "");
   nmeResultsLogger->info("Using information from {}\n\n",
-                         GetNMEOpt(std::string, input));
+                         options.Get<std::string>("input"));
   nmeResultsLogger->info("Nuclear potential: {}", potential);
   nmeResultsLogger->info(
       "Transition from {}{} [{}/2] ({} keV) to {}{} [{}/2] ({} keV)", Am,
@@ -120,7 +125,7 @@ void NS::NuclearStructureManager::InitializeConstants() {
 }
 
 void NS::NuclearStructureManager::InitializeLoggers() {
-  SetOutputName(GetNMEOpt(std::string, output));
+  SetOutputName(options.Get<std::string>("output"));
 
   /**
    * Remove result & log files if they already exist
@@ -128,27 +133,18 @@ void NS::NuclearStructureManager::InitializeLoggers() {
   if (std::ifstream(outputName + ".nme"))
     std::remove((outputName + ".nme").c_str());
 
-  debugFileLogger = spdlog::get("debug_file");
   if (!debugFileLogger) {
-    debugFileLogger = spdlog::basic_logger_st(
-        "debug_file", outputName + ".log");
-    debugFileLogger->set_level(spdlog::level::debug);
+    debugFileLogger = bsg::logging::CreateDebugFileLogger(
+        outputName + ".log", options.Get<std::string>("log-level"), !options.Exists("no-log-files"));
   }
   debugFileLogger->debug("Debugging logger found in NSM");
-  consoleLogger = spdlog::get("console");
-  if (!consoleLogger) {
-    consoleLogger = spdlog::stdout_color_st("console");
-    consoleLogger->set_level(spdlog::level::warn);
-  }
+  consoleLogger = bsg::logging::GetConsoleLogger(false);
   debugFileLogger->debug("Console logger found in NSM");
-  nmeResultsLogger = spdlog::get("nme_results_file");
-  if (!nmeResultsLogger) {
-    nmeResultsLogger = spdlog::basic_logger_st(
-        "nme_results_file", outputName + ".nme");
-    nmeResultsLogger->set_level(spdlog::level::info);
-    nmeResultsLogger->set_pattern("%v");
-  }
-  ShowNMEInfo();
+  nmeResultsLogger = std::make_shared<spdlog::logger>(
+      "nme_results_file", std::make_shared<spdlog::sinks::basic_file_sink_st>(outputName + ".nme"));
+  nmeResultsLogger->set_level(spdlog::level::info);
+  nmeResultsLogger->set_pattern("%v");
+  ShowNMEInfo(nmeResultsLogger);
   debugFileLogger->debug("NME Results logger found in NSM");
 }
 void NS::NuclearStructureManager::SetDaughterNucleus(int Z, int A, int dJ,
@@ -186,14 +182,14 @@ void NS::NuclearStructureManager::Initialize(std::string m, std::string p) {
     }
     initialized = true;
   } else if (boost::iequals(method, "ROBTD")) {
-    if (!NMEOptExists(Transition.ROBTDFile)) {
+    if (!options.Exists("Transition.ROBTDFile")) {
       consoleLogger->error(
           "Reduced One Body Transition Density file was not specified in"
           "transition .ini file. Initializing using Method=ESP.");
       Initialize("ESP", p);
     } else {
       initialized = BuildDensityMatrixFromFile(
-          GetNMEOpt(std::string, Transition.ROBTDFile));
+          options.Get<std::string>("Transition.ROBTDFile"));
     }
   }
   debugFileLogger->debug("Leaving Initialize");
@@ -318,24 +314,24 @@ void NS::NuclearStructureManager::GetESPStates(SingleParticleState& spsi,
                                                SingleParticleState& spsf,
                                                int& dKi, int& dKf) {
   debugFileLogger->debug("Entered GetESPStates");
-  double Vp = GetNMEOpt(double, Computational.Vproton);
-  double Vn = GetNMEOpt(double, Computational.Vneutron);
-  double Xn = GetNMEOpt(double, Computational.Xneutron);
-  double Xp = GetNMEOpt(double, Computational.Xproton);
-  double A0 = GetNMEOpt(double, Computational.SurfaceThickness);
-  double VSp = GetNMEOpt(double, Computational.V0Sproton);
-  double VSn = GetNMEOpt(double, Computational.V0Sneutron);
+  double Vp = options.Get<double>("Computational.Vproton");
+  double Vn = options.Get<double>("Computational.Vneutron");
+  double Xn = options.Get<double>("Computational.Xneutron");
+  double Xp = options.Get<double>("Computational.Xproton");
+  double A0 = options.Get<double>("Computational.SurfaceThickness");
+  double VSp = options.Get<double>("Computational.V0Sproton");
+  double VSn = options.Get<double>("Computational.V0Sneutron");
 
   debugFileLogger->debug("Found all Potential constants");
 
   int dJReqIn = mother.dJ;
   int dJReqFin = daughter.dJ;
   if (mother.A % 2 == 0) {
-    dJReqIn = GetNMEOpt(int, Mother.ForcedSPSpin);
-    dJReqFin = GetNMEOpt(int, Daughter.ForcedSPSpin);
+    dJReqIn = options.Get<int>("Mother.ForcedSPSpin");
+    dJReqFin = options.Get<int>("Daughter.ForcedSPSpin");
   }
 
-  double threshold = GetNMEOpt(double, Computational.EnergyMargin);
+  double threshold = options.Get<double>("Computational.EnergyMargin");
 
   debugFileLogger->debug("Threshold: {} MeV", threshold);
 
@@ -368,35 +364,36 @@ void NS::NuclearStructureManager::GetESPStates(SingleParticleState& spsi,
       mBeta4 = mother.beta4;
       mBeta6 = mother.beta6;
     }
-    if (!GetNMEOpt(bool, Computational.ForceSpin)) {
+    if (!options.Get<bool>("Computational.ForceSpin")) {
       threshold = 0.0;
     }
+    bsg::logging::Loggers loggers = {consoleLogger, debugFileLogger, nmeResultsLogger};
     if (betaType == BETA_MINUS) {
       nmeResultsLogger->info("Proton State\n{:=>20}", "");
       spsf = NO::CalculateDeformedSPState(
           daughter.Z, 0, daughter.A, daughter.dJ, dR, dBeta2, dBeta4, dBeta6,
-          V0p, A0, VSp, dJReqFin, threshold);
+          V0p, A0, VSp, dJReqFin, threshold, loggers);
       nmeResultsLogger->info("Neutron State\n{:=>20}", "");
       spsi = NO::CalculateDeformedSPState(0, mother.A - mother.Z, mother.A,
                                           mother.dJ, mR, mBeta2, mBeta4, mBeta6,
-                                          V0n, A0, VSn, dJReqIn, threshold);
+                                          V0n, A0, VSn, dJReqIn, threshold, loggers);
     } else {
       nmeResultsLogger->info("Neutron State\n{:=>20}", "");
       spsf = NO::CalculateDeformedSPState(
           0, daughter.A - daughter.Z, daughter.A, daughter.dJ, dR, dBeta2,
-          dBeta4, dBeta6, V0n, A0, VSn, dJReqFin, threshold);
+          dBeta4, dBeta6, V0n, A0, VSn, dJReqFin, threshold, loggers);
       nmeResultsLogger->info("Proton State\n{:=>20}", "");
       spsi = NO::CalculateDeformedSPState(mother.Z, 0, mother.A, mother.dJ, mR,
                                           mBeta2, mBeta4, mBeta6, V0p, A0, VSp,
-                                          dJReqIn, threshold);
+                                          dJReqIn, threshold, loggers);
     }
   }
 
-  if (GetNMEOpt(bool, Computational.OverrideSPCoupling)) {
+  if (options.Get<bool>("Computational.OverrideSPCoupling")) {
     dKi = std::abs(mother.dJ);
     dKf = std::abs(daughter.dJ);
   } else {
-    bool reversedGhallagher = GetNMEOpt(bool, Computational.ReversedGhallagher);
+    bool reversedGhallagher = options.Get<bool>("Computational.ReversedGhallagher");
 
     if (boost::iequals(potential, "DWS") && mother.beta2 != 0.0 &&
         daughter.beta2 != 0.0) {
@@ -490,11 +487,11 @@ double NS::NuclearStructureManager::GetESPManyParticleCoupling(
     int dT3f = daughter.A - 2 * daughter.Z;
     int dTi = std::abs(dT3i);
     int dTf = std::abs(dT3f);
-    if (NMEOptExists(Mother.Isospin)) {
-      dTi = GetNMEOpt(int, Mother.Isospin);
+    if (options.Exists("Mother.Isospin")) {
+      dTi = options.Get<int>("Mother.Isospin");
     }
-    if (NMEOptExists(NuclearPropertiesDaughterIsospin)) {
-      dTf = GetNMEOpt(int, Daughter.Isospin);
+    if (options.Exists("NuclearPropertiesDaughterIsospin")) {
+      dTf = options.Get<int>("Daughter.Isospin");
     }
     /*if ((dJi + dT3i) / 2 % 2 == 0) {
       dTi = dT3i + 1;
@@ -565,8 +562,8 @@ double NS::NuclearStructureManager::GetESPManyParticleCoupling(
 double NS::NuclearStructureManager::CalculateReducedMatrixElement(bool V, int K, int L,
                                                            int s) {
   if (!initialized) {
-    Initialize(GetNMEOpt(std::string, Computational.Method),
-               GetNMEOpt(std::string, Computational.Potential));
+    Initialize(options.Get<std::string>("Computational.Method"),
+               options.Get<std::string>("Computational.Potential"));
   }
   double result = 0.0;
   double nu = CD::CalcNu(mother.R * std::sqrt(3. / 5.), mother.Z);
@@ -630,8 +627,8 @@ double NS::NuclearStructureManager::CalculateReducedMatrixElement(bool V, int K,
 double NS::NuclearStructureManager::CalculateWeakMagnetism() {
   double result = 0.0;
 
-  double gM = GetNMEOpt(double, Constants.gM);
-  double gAeff = GetNMEOpt(double, Constants.gAeff);
+  double gM = options.Get<double>("Constants.gM");
+  double gAeff = options.Get<double>("Constants.gAeff");
 
   double VM111 = CalculateReducedMatrixElement(true, 1, 1, 1);
   double AM101 = CalculateReducedMatrixElement(false, 1, 0, 1);
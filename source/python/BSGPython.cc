@@ -0,0 +1,186 @@
+#include "Generator.h"
+#include "BSGOptionContainer.h"
+#include "NMEOptionContainer.h"
+#include "NuclearStructureManager.h"
+
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "pybind11/numpy.h"
+#include "pybind11/pybind11.h"
+#include "pybind11/stl.h"
+
+namespace py = pybind11;
+namespace NS = nme::NuclearStructure;
+
+namespace {
+/**
+ * Split a dict of options into command line arguments, for the options
+ * without a section such as output, threads or config, and option values for
+ * those named Section.Name, which take the place of the input file.
+ * Booleans of command line switches such as no-log-files add the switch
+ * when true. Sequences, e.g. for Spectrum.vnew, are joined by spaces.
+ */
+void ReadOptions(const py::dict& options, std::vector<std::string>& arguments, nme::OptionValues& values) {
+  for (auto item : options) {
+    std::string name = py::str(item.first);
+    py::handle value = item.second;
+    bool isBool = py::isinstance<py::bool_>(value);
+    std::string text;
+    if (isBool) {
+      text = value.cast<bool>() ? "true" : "false";
+    } else if (py::isinstance<py::str>(value)) {
+      text = value.cast<std::string>();
+    } else if (py::isinstance<py::sequence>(value)) {
+      for (auto x : value.cast<py::sequence>()) {
+        text += (text.empty() ? "" : " ") + std::string(py::str(x));
+      }
+    } else {
+      text = py::str(value);
+    }
+
+    if (name.find('.') != std::string::npos) {
+      values.push_back(std::make_pair(name, text));
+    } else if (!isBool) {
+      arguments.push_back("--" + name);
+      arguments.push_back(text);
+    } else if (value.cast<bool>()) {
+      arguments.push_back("--" + name);
+    }
+  }
+}
+
+/**
+ * Parse a dict of options like the command line and input file of bsg_exec
+ */
+bsg::BSGOptions GetBSGOptions(const py::dict& options) {
+  std::vector<std::string> arguments = {"pybsg"};
+  nme::OptionValues values;
+  ReadOptions(options, arguments, values);
+  std::vector<char*> argv;
+  for (auto& a : arguments) argv.push_back(&a[0]);
+  return bsg::BSGOptionContainer((int)argv.size(), argv.data(), &values).GetOptions();
+}
+
+/**
+ * Parse a dict of options like the command line and input file of nme_exec
+ */
+nme::NMEOptions GetNMEOptions(const py::dict& options) {
+  std::vector<std::string> arguments = {"pybsg"};
+  nme::OptionValues values;
+  ReadOptions(options, arguments, values);
+  std::vector<char*> argv;
+  for (auto& a : arguments) argv.push_back(&a[0]);
+  return nme::NMEOptionContainer((int)argv.size(), argv.data(), &values).GetOptions();
+}
+
+/**
+ * Read-only array viewing a column owned by another Python object, which is
+ * kept alive as long as the array exists
+ */
+py::array_t<double> View(const std::vector<double>& column, py::handle owner) {
+  py::array_t<double> array({column.size()}, {sizeof(double)}, column.data(), owner);
+  array.attr("flags").attr("writeable") = false;
+  return array;
+}
+
+/**
+ * Array taking over the buffer of a vector
+ */
+py::array_t<double> ToArray(std::vector<double>&& column) {
+  auto owned = new std::vector<double>(std::move(column));
+  py::capsule owner(owned, [](void* v) { delete static_cast<std::vector<double>*>(v); });
+  return py::array_t<double>({owned->size()}, {sizeof(double)}, owned->data(), owner);
+}
+}
+
+PYBIND11_MODULE(pybsg, m) {
+  m.doc() =
+      "Python bindings of the BSG and NME libraries. Options are given as a dict with the names used "
+      "on the command line and in input and configuration files, e.g. {'Mother.Z': 2, 'threads': 4}.";
+
+  py::class_<bsg::Spectrum, std::shared_ptr<bsg::Spectrum> >(
+      m, "Spectrum",
+      "Calculated spectrum. Its columns are read-only NumPy arrays sharing the memory of the "
+      "calculation, which stays valid as long as any of them is used.")
+      .def("__len__", &bsg::Spectrum::Size)
+      .def_property_readonly(
+          "W", [](py::object self) { return View(self.cast<const bsg::Spectrum&>().GetW(), self); },
+          "total electron energies in units of the electron rest mass")
+      .def_property_readonly(
+          "electron", [](py::object self) { return View(self.cast<const bsg::Spectrum&>().GetElectron(), self); },
+          "electron decay rates")
+      .def_property_readonly(
+          "neutrino", [](py::object self) { return View(self.cast<const bsg::Spectrum&>().GetNeutrino(), self); },
+          "neutrino decay rates")
+      .def_property_readonly(
+          "columns",
+          [](py::object self) {
+            py::dict columns;
+            for (const auto& c : self.cast<const bsg::Spectrum&>().GetColumns()) {
+              columns[py::str(c.first)] = View(c.second, self);
+            }
+            return columns;
+          },
+          "additional columns, such as the factors of every correction with the breakdown option");
+
+  py::class_<bsg::Generator>(m, "Generator")
+      .def(py::init([](const py::dict& options) { return new bsg::Generator(GetBSGOptions(options)); }),
+           py::arg("options"),
+           "Set up the calculation of a transition. The transition options such as Mother.Z are given in "
+           "the dict instead of an input file.")
+      .def("CalculateSpectrum",
+           [](bsg::Generator& gen) {
+             {
+               py::gil_scoped_release release;
+               gen.CalculateSpectrum();
+             }
+             return std::make_shared<bsg::Spectrum>(gen.ReleaseSpectrum());
+           },
+           "Calculate the spectrum, which is handed over without copying and also written to the output files.")
+      .def("CalculateDecayRate",
+           [](bsg::Generator& gen, double W) {
+             py::gil_scoped_release release;
+             return gen.CalculateDecayRate(W);
+           },
+           py::arg("W"), "Electron and neutrino decay rates at total electron energy W")
+      .def("CalculateDecayRate",
+           [](bsg::Generator& gen, py::array_t<double, py::array::c_style | py::array::forcecast> W) {
+             std::vector<double> electron(W.size()), neutrino(W.size());
+             const double* w = W.data();
+             {
+               py::gil_scoped_release release;
+               for (std::size_t i = 0; i < electron.size(); i++) {
+                 std::tie(electron[i], neutrino[i]) = gen.CalculateDecayRate(w[i]);
+               }
+             }
+             return py::make_tuple(ToArray(std::move(electron)), ToArray(std::move(neutrino)));
+           },
+           py::arg("W"), "Electron and neutrino decay rates at every total electron energy of an array")
+      .def("CalculateBinIntegrals",
+           [](bsg::Generator& gen, std::vector<double> edges, int order, int nThreads) {
+             std::vector<double> electron, neutrino;
+             {
+               py::gil_scoped_release release;
+               gen.CalculateBinIntegrals(edges, order, electron, neutrino, nThreads);
+             }
+             return py::make_tuple(ToArray(std::move(electron)), ToArray(std::move(neutrino)));
+           },
+           py::arg("edges"), py::arg("order") = 8, py::arg("threads") = 1,
+           "Electron and neutrino decay rates integrated over bins with the given edges in keV");
+
+  py::class_<NS::NuclearStructureManager>(m, "NuclearStructureManager")
+      .def(py::init([](const py::dict& options) { return new NS::NuclearStructureManager(GetNMEOptions(options)); }),
+           py::arg("options"),
+           "Set up the nuclear structure of a transition. The transition options such as Mother.Z are "
+           "given in the dict instead of an input file.")
+      .def("CalculateWeakMagnetism", &NS::NuclearStructureManager::CalculateWeakMagnetism,
+           py::call_guard<py::gil_scoped_release>(), "Weak magnetism form factor b/Ac")
+      .def("CalculateInducedTensor", &NS::NuclearStructureManager::CalculateInducedTensor,
+           py::call_guard<py::gil_scoped_release>(), "Induced tensor form factor d/Ac")
+      .def("CalculateReducedMatrixElement", &NS::NuclearStructureManager::CalculateReducedMatrixElement,
+           py::call_guard<py::gil_scoped_release>(), py::arg("V"), py::arg("K"), py::arg("L"), py::arg("s"),
+           "Reduced matrix element ^XM_{KLs}, with X = V when V is true and A otherwise");
+}
@@ -0,0 +1,78 @@
+"""
+Smoke test of the pybsg module, run by CTest when it is built with BSG_PYTHON.
+
+Calculates the spectrum of the Gamow-Teller decay of 45Ca and checks that its
+arrays stay valid after the generator and spectrum objects are deleted, and
+that the decay rates of an array agree with the spectrum.
+
+Usage: smoke_test.py <data directory with config.txt and ExchangeData.dat>
+"""
+import gc
+import os
+import sys
+import tempfile
+
+import numpy as np
+
+import pybsg
+
+
+def Options(data, output):
+    return {
+        "config": os.path.join(data, "config.txt"),
+        "exchangedata": os.path.join(data, "ExchangeData.dat"),
+        "output": os.path.join(output, "45Ca"),
+        "no-log-files": True,
+        "Transition.Process": "B-",
+        "Transition.Type": "Gamow-Teller",
+        "Transition.MixingRatio": 0.0,
+        "Transition.QValue": 255.8,
+        "Mother.Z": 20,
+        "Mother.A": 45,
+        "Mother.Radius": 3.49,
+        "Mother.Beta2": -0.011,
+        "Mother.SpinParity": -7,
+        "Mother.ExcitationEnergy": 0.0,
+        "Daughter.Z": 21,
+        "Daughter.A": 45,
+        "Daughter.Radius": 3.55,
+        "Daughter.Beta2": 0.043,
+        "Daughter.Beta6": 0.013,
+        "Daughter.SpinParity": -7,
+        "Daughter.ExcitationEnergy": 0.0,
+    }
+
+
+def main(data):
+    output = tempfile.mkdtemp()
+    options = Options(data, output)
+
+    gen = pybsg.Generator(options)
+    spectrum = gen.CalculateSpectrum()
+    n = len(spectrum)
+    W, electron = spectrum.W, spectrum.electron
+    assert n > 10, "spectrum has only {} points".format(n)
+    assert W.shape == (n,) and electron.shape == (n,)
+    assert not W.flags.writeable and not electron.flags.writeable
+    expected = np.array(electron)
+
+    # the arrays keep the memory of the calculation alive on their own
+    del gen, spectrum
+    gc.collect()
+    assert np.array_equal(electron, expected)
+    assert np.all(np.isfinite(W)) and np.all(np.isfinite(electron))
+    assert np.all(np.diff(W) > 0) and electron[n // 2] > 0
+
+    gen = pybsg.Generator(options)
+    rates, neutrino = gen.CalculateDecayRate(W[1:-1])
+    assert rates.shape == (n - 2,) and neutrino.shape == (n - 2,)
+    assert np.allclose(rates, expected[1:-1], rtol=1e-8, atol=0)
+    rate, _ = gen.CalculateDecayRate(float(W[n // 2]))
+    assert np.isclose(rate, expected[n // 2], rtol=1e-8, atol=0)
+
+    print("pybsg smoke test passed on {} points".format(n))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1]))